@@ -0,0 +1,41 @@
+# builds read-only blobs pack for EmbUI's 'assets' flash partition, see embuifs::BlobPack
+# usage: python3 blobpack.py <dir> <pack.bin>
+#   all files under <dir> are packed with names relative to <dir>, i.e. data/js/ui_embui.json -> /js/ui_embui.json
+# flash it with: parttool.py write_partition --partition-name=assets --input <pack.bin>
+import os
+import struct
+import sys
+
+MAGIC = b'EUIB'
+VERSION = 1
+NAME_LEN = 48       # EMBUIFS_BLOB_NAME_LEN
+ALIGN = 4
+
+def build(root, out):
+    files = []
+    for d, _, names in os.walk(root):
+        for n in sorted(names):
+            path = os.path.join(d, n)
+            name = '/' + os.path.relpath(path, root).replace(os.sep, '/')
+            if len(name.encode()) >= NAME_LEN:
+                sys.exit(f'name is too long: {name}')
+            with open(path, 'rb') as f:
+                files.append((name, f.read()))
+
+    offset = 8 + len(files) * (NAME_LEN + 8)
+    index = b''
+    data = b''
+    for name, content in files:
+        pad = -(offset + len(data)) % ALIGN
+        data += b'\0' * pad
+        index += struct.pack(f'<{NAME_LEN}sII', name.encode(), offset + len(data), len(content))
+        data += content
+
+    with open(out, 'wb') as f:
+        f.write(MAGIC + struct.pack('<HH', VERSION, len(files)) + index + data)
+    print(f'{len(files)} blobs, {8 + len(index) + len(data)} bytes')
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit('usage: blobpack.py <dir> <pack.bin>')
+    build(sys.argv[1], sys.argv[2])
@@ -436,10 +436,98 @@ var mustache = function(tmpl,func){
   }
 }(mustache.prototype));
 
+// MessagePack codec, supports data types that could be found in EmbUI frames
+var msgpack = {
+  encode: function(val){
+    var b = [], te = new TextEncoder(),
+    uint = function(n, len){ for (var i = len-1; i >= 0; i--) b.push((n / Math.pow(2, 8*i)) & 0xff); },
+    hdr = function(len, fix, c16){
+      if (len < 16) b.push(fix | len);
+      else if (len < 65536){ b.push(c16); uint(len, 2); }
+      else { b.push(c16 + 1); uint(len, 4); }
+    },
+    enc = function(v){
+      if (v === null || v === undefined) b.push(0xc0);
+      else if (typeof v == "boolean") b.push(v ? 0xc3 : 0xc2);
+      else if (typeof v == "number"){
+        if (Number.isInteger(v) && v >= -2147483648 && v <= 4294967295){
+          if (v >= 0 && v < 128) b.push(v);
+          else if (v < 0 && v >= -32) b.push(v & 0xff);
+          else if (v >= 0){ b.push(0xce); uint(v, 4); }
+          else { b.push(0xd2); uint(v >>> 0, 4); }
+        } else {
+          var f = new DataView(new ArrayBuffer(8));
+          f.setFloat64(0, v);
+          b.push(0xcb);
+          for (var i = 0; i < 8; i++) b.push(f.getUint8(i));
+        }
+      } else if (typeof v == "string"){
+        var s = te.encode(v), l = s.length;
+        if (l < 32) b.push(0xa0 | l);
+        else if (l < 256) b.push(0xd9, l);
+        else if (l < 65536){ b.push(0xda); uint(l, 2); }
+        else { b.push(0xdb); uint(l, 4); }
+        for (var i = 0; i < l; i++) b.push(s[i]);
+      } else if (Array.isArray(v)){
+        hdr(v.length, 0x90, 0xdc);
+        v.forEach(enc);
+      } else if (typeof v == "object"){
+        var k = Object.keys(v);
+        hdr(k.length, 0x80, 0xde);
+        k.forEach(function(i){ enc(i); enc(v[i]); });
+      } else b.push(0xc0);
+    };
+    enc(val);
+    return new Uint8Array(b);
+  },
+  decode: function(buf){
+    var dv = new DataView(buf.buffer, buf.byteOffset, buf.byteLength), p = 0, td = new TextDecoder(),
+    rd = function(fn, len){ var v = dv[fn](p); p += len; return v; },
+    str = function(l){ var s = td.decode(buf.subarray(p, p + l)); p += l; return s; },
+    arr = function(l){ var a = []; while (l--) a.push(dec()); return a; },
+    map = function(l){ var o = {}; while (l--){ var k = dec(); o[k] = dec(); } return o; },
+    dec = function(){
+      var t = buf[p++];
+      if (t < 0x80) return t;
+      if (t < 0x90) return map(t & 0x0f);
+      if (t < 0xa0) return arr(t & 0x0f);
+      if (t < 0xc0) return str(t & 0x1f);
+      if (t >= 0xe0) return t - 0x100;
+      switch (t){
+        case 0xc0: return null;
+        case 0xc2: return false;
+        case 0xc3: return true;
+        case 0xca: return rd("getFloat32", 4);
+        case 0xcb: return rd("getFloat64", 8);
+        case 0xcc: return rd("getUint8", 1);
+        case 0xcd: return rd("getUint16", 2);
+        case 0xce: return rd("getUint32", 4);
+        case 0xcf: return rd("getUint32", 4) * 4294967296 + rd("getUint32", 4);
+        case 0xd0: return rd("getInt8", 1);
+        case 0xd1: return rd("getInt16", 2);
+        case 0xd2: return rd("getInt32", 4);
+        case 0xd3: return rd("getInt32", 4) * 4294967296 + rd("getUint32", 4);
+        case 0xd9: return str(rd("getUint8", 1));
+        case 0xda: return str(rd("getUint16", 2));
+        case 0xdb: return str(rd("getUint32", 4));
+        case 0xdc: return arr(rd("getUint16", 2));
+        case 0xdd: return arr(rd("getUint32", 4));
+        case 0xde: return map(rd("getUint16", 2));
+        case 0xdf: return map(rd("getUint32", 4));
+      }
+      throw new Error("msgpack: unsupported type 0x" + t.toString(16));
+    };
+    return dec();
+  }
+};
+
 var wbs = function(url){
-  var ws = null, frame = {}, connected = false, lastmsg = null, to = null,
+  // bin - server talks MessagePack, set on first binary message received
+  var ws = null, frame = {}, connected = false, lastmsg = null, to = null, bin = false,
   open = function(fnopen, fnerror){
     ws = new WebSocket(url);
+    ws.binaryType = "arraybuffer";
+    bin = false;
     ws.onerror = function(err){
       console.log("WS Error", err);
       if (fnerror) fnerror(err);
@@ -462,7 +550,12 @@ var wbs = function(url){
     }
     ws.onmessage = function(msg){
       let m = {};
-      try{ m = JSON.parse(msg.data); } catch(e){ console.log('Error message', e); return; }
+      try{
+        if (msg.data instanceof ArrayBuffer){
+          m = msgpack.decode(new Uint8Array(msg.data));
+          bin = true;
+        } else m = JSON.parse(msg.data);
+      } catch(e){ console.log('Error message', e); return; }
       //console.log('Received message:', msg.data);
       if (!(m instanceof Object)) return;
       if (m.section && !(m.section in frame) && m.final){
@@ -492,7 +585,7 @@ var wbs = function(url){
   send = function(msg){ try{ ws.send(msg); }catch(e){} },
   send_msg = function(msg){
     console.log('Sending message:', msg);
-    try{ lastmsg = JSON.stringify(msg); } catch(e){ console.log('Error stringify', e); return; }
+    try{ lastmsg = bin ? msgpack.encode(msg) : JSON.stringify(msg); } catch(e){ console.log('Error stringify', e); return; }
     if (ws.readyState === WebSocket.OPEN){
       send(lastmsg);
       lastmsg = null;
@@ -513,6 +606,12 @@ var wbs = function(url){
     send_post: function(id, val){
       //console.log("POST action:", id, "data:", val);
       send_msg({pkg:"post", "action":id, "data":val});
+    },
+    // subscribe to values of elements that are present on the page, server sends values only for those
+    // rate - optional {id:ms} object with min intervals between value updates
+    subscribe: function(rate){
+      let keys = Array.from(document.querySelectorAll("[id]"), function(e){ return e.id; });
+      send_msg({pkg:"sub", "keys":keys, "rate":rate});
     }
   };
   return out;
@@ -1343,10 +1442,15 @@ var render = function(){
 
 window.addEventListener("load", async function(ev){
   var rdr = this.rdr = render();
-  var ws = this.ws = wbs("ws://"+location.host+"/ws");
-
-  // process "pkg":"interface"
-  ws.oninterface = function(msg) { rdr.make(msg) }
+  var ws = this.ws = wbs("ws://"+location.host+"/ws?fmt=msgpack");   // ask for MessagePack protocol, server falls back to json if not supported
+
+  // process "pkg":"interface", once page elements are rendered subscribe to it's values
+  var subto = null;
+  ws.oninterface = async function(msg) {
+    await rdr.make(msg);
+    clearTimeout(subto);
+    subto = setTimeout(function(){ ws.subscribe() }, 200);
+  }
 
   // run custom js function in window context
   ws.onjscall = function(msg) {
@@ -3,14 +3,17 @@
 // also many thanks to Vortigont (https://github.com/vortigont), kDn (https://github.com/DmytroKorniienko)
 // and others people
 
+#include <cstring>
+#include <map>
 #include <string_view>
 #include "EmbUI.h"
 #include "ui.h"
 #include "basicui.h"
+#include "embui_framecache.hpp"
 #include "ftpsrv.h"
 #include "nvs_handle.hpp"
 
-#define POST_ACTION_DELAY   10      // delay for large posts processing in ms
+#define ACTION_MATCH_BUFF   8       // number of matched action handlers kept on stack in ActionHandler::exec()
 //#define POST_LARGE_SIZE     1024    // large post threshold
 
 // instance of embui object
@@ -23,9 +26,100 @@ union MacID
     uint8_t mc[8];
 };
 
+/**
+ * @brief WebSocket messages reassembly
+ * keeps per-client buffers for messages that arrive in multiple frames or TCP segments
+ * 
+ */
+class WSReassembly {
+    struct msg_t {
+        std::vector<uint8_t> data;
+        // message exceeds size limits and it's remaining fragments must be skipped
+        bool drop{false};
+    };
+
+    // message buffers by client id
+    std::map<uint32_t, msg_t> _msgs;
+    // total size of all buffers
+    size_t _size{0};
+
+public:
+    /**
+     * @brief append message fragment to client's buffer
+     * 
+     * @return pointer to reassembled message data if fragment completes the message, nullptr otherwise
+     * @note returned buffer must be released with release() after processing
+     */
+    const std::vector<uint8_t>* add(uint32_t id, const AwsFrameInfo *info, const uint8_t *data, size_t len);
+
+    /**
+     * @brief release client's buffer
+     * 
+     * @param id client id
+     */
+    void release(uint32_t id);
+};
+
+void WSReassembly::release(uint32_t id){
+    auto i = _msgs.find(id);
+    if (i == _msgs.end()) return;
+    _size -= i->second.data.size();
+    _msgs.erase(i);
+}
+
+const std::vector<uint8_t>* WSReassembly::add(uint32_t id, const AwsFrameInfo *info, const uint8_t *data, size_t len){
+    // first fragment of a new message, drop any stale leftovers
+    if (info->num == 0 && info->index == 0)
+        release(id);
+    else if (_msgs.find(id) == _msgs.end())
+        return nullptr;     // missed the beginning of the message, nothing to assemble
+
+    msg_t &m = _msgs[id];
+
+    // frame's length announced by client is checked on it's first segment, it is used to reserve space
+    size_t need = info->index == 0 ? std::max<size_t>(len, info->len) : len;
+    if (!m.drop && (m.data.size() + need > EMBUI_WS_MAX_MSG_SIZE || _size + need > EMBUI_WS_REASSEMBLY_BUDGET)){
+        LOGW(P_EmbUI, printf, "WS msg from client:%u exceeds size limits, dropping\n", id);
+        _size -= m.data.size();
+        m.data = std::vector<uint8_t>();
+        m.drop = true;
+    }
+
+    bool last = info->final && (info->index + len == info->len);
+
+    if (m.drop){
+        if (last) release(id);
+        return nullptr;
+    }
+
+    // reserve space for the whole frame on it's first segment, frame's length is within limits checked above
+    if (info->index == 0)
+        m.data.reserve(std::min<size_t>(m.data.size() + info->len, EMBUI_WS_MAX_MSG_SIZE));
+
+    m.data.insert(m.data.end(), data, data + len);
+    _size += len;
+    LOGV(P_EmbUI, printf, "WS fragment cl:%u num:%u, idx:%u, len:%u, msg size:%u\n", id, info->num, info->index, len, m.data.size());
+
+    return last ? &m.data : nullptr;
+}
+
+static WSReassembly ws_reassembly;
+
+// WebSocket url query parameter to negotiate MessagePack protocol, i.e. /ws?fmt=msgpack
+static constexpr const char* T_fmt = "fmt";
+static constexpr const char* T_msgpack = "msgpack";
+
 // forward declaration
 void wsDataHandler(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
 
+/**
+ * @brief process complete WebSocket message with posted data or value subscription
+ * 
+ * @param client message sender
+ * @param msgpack - data is a MessagePack binary message, otherwise json text
+ */
+void wsPostHandler(AsyncWebSocketClient *client, const uint8_t *data, size_t len, bool msgpack);
+
 /**
  * WebSocket events handler
  *
@@ -38,19 +132,32 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
 
     if(type == WS_EVT_CONNECT){
         LOGD(P_EmbUI, printf, "WS_EVT_CONNECT:%s id:%u\n", server->url(), client->id());
+        // client supports MessagePack protocol
+        auto req = static_cast<AsyncWebServerRequest*>(arg);
+        if (req && req->hasParam(T_fmt) && req->getParam(T_fmt)->value() == T_msgpack)
+            WSEgress::getInstance().msgpack(client->id(), true);
         {
             Interface interf(client);
-            embui.publish_language(&interf);
-
-            if (!embui.action.exec(&interf, {}, A_ui_page_main))    // call user defined mainpage callback
-                basicui::page_main(&interf);                        // if no callback was registered, then show default stub page
+            interf.json_frame_streaming(true);                      // main page could be large, serialize it on the fly
+            // language and mainpage frames are same for all clients until config changes, build it once
+            // main page runs user's actions, it is cached only if opted in
+            auto &cache = FrameCache::getInstance();
+            cache.build(&interf, cache.cacheable(A_ui_page_main) ? FrameCache::key(A_ui_page_main) : 0, [&interf](){
+                embui.publish_language(&interf);
+                if (!embui.action.exec(&interf, {}, A_ui_page_main))    // call user defined mainpage callback
+                    basicui::page_main(&interf);                        // if no callback was registered, then show default stub page
+            });
+            ValueCache::getInstance().snapshot(&interf);            // current values for the new client, publisher will send only changes
         }
-        embui.send_pub();
+        // runs on AsyncTCP task, system stats are left to the periodic publisher
+        embui.send_pub(false);
         return;
     }
 
     if(type == WS_EVT_DISCONNECT){
         LOGD(P_EmbUI, printf, "WS_EVT_DISCONNECT:%s id:%u\n", server->url(), client->id());
+        ws_reassembly.release(client->id());
+        WSEgress::getInstance().release(client->id());
         return;
     }
 
@@ -70,53 +177,56 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
 void wsDataHandler(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len){
     AwsFrameInfo *info = (AwsFrameInfo*)arg;
 
-    // fragmented messages reassembly is not (yet) supported
-    if(!info->final || info->index != 0 || info->len != len){
-        LOGV(P_EmbUI, printf, "WS fragment fin:%u, idx:%u, len:%u\n", info->final, info->index, len);
-        return;
-    }
+    // complete message in a single frame
+    if(info->final && info->num == 0 && info->index == 0 && info->len == len)
+        return wsPostHandler(client, data, len, info->opcode == WS_BINARY);
+
+    // fragmented message, reassemble it in client's buffer
+    auto msg = ws_reassembly.add(client->id(), info, data, len);
+    if (!msg) return;
+
+    wsPostHandler(client, msg->data(), msg->size(), info->message_opcode == WS_BINARY);
+    ws_reassembly.release(client->id());
+}
 
-    // ignore packets without "pkg":"post" marker
+void wsPostHandler(AsyncWebSocketClient *client, const uint8_t *data, size_t len, bool msgpack){
     std::string_view payload((const char *)data, len);
-    if (payload.substr(1, 12) != "\"pkg\":\"post\""){
-        LOGW(P_EmbUI, println, "bad post pkt");
+
+    // value subscription {"pkg":"sub", ...}, it affects only client's egress, so it is applied right away
+    if (msgpack ? payload.substr(1, 8) == "\xa3pkg\xa3sub" : payload.substr(1, 11) == "\"pkg\":\"sub\""){
+        JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::ingress));
+        auto err = msgpack ? deserializeMsgPack(doc, data, len) : deserializeJson(doc, data, len);
+        if (err)
+            LOGW(P_EmbUI, printf, "bad sub pkt: %s\n", err.c_str());
+        else
+            WSEgress::getInstance().subscribe(client, doc);
         return;
     }
 
-    JsonDocument *res = new JsonDocument();
-
-    DeserializationError error = deserializeJson((*res), (const char*)data, len); // deserialize via copy to prevent dangling pointers in action()'s
-    if (error){
-        LOGE(P_EmbUI, printf, "WS_EVT_DATA deserialization err: %d\n", error.code());
-        delete res;
+    // ignore packets without "pkg":"post" marker, it is the first key in a map, i.e. {"pkg":"post", ...}
+    if (msgpack ? payload.substr(1, 9) != "\xa3pkg\xa4post" : payload.substr(1, 12) != "\"pkg\":\"post\""){
+        LOGW(P_EmbUI, println, "bad post pkt");
         return;
     }
 
     // switch context to the main loop() for processing data
-    Task *t = new Task(POST_ACTION_DELAY, TASK_ONCE,
-        [res](){
-            // if there is nested data in the object
-            // call action handler for post'ed data
-            embui.post(res->as<JsonObject>());
-            delete res; },
-        &ts, false, nullptr, nullptr, true
-    );
-    if (t)
-        t->enableDelayed();
-    else
-        delete res;
+    embui.ingress((const char*)data, len, nullptr, msgpack);
 }
 
 // EmbUI constructor
 EmbUI::EmbUI() : server(80), ws(EMBUI_WEBSOCK_URI){
         _getmacid();
 
-        tAutoSave.set(EMBUI_AUTOSAVE_TIMEOUT * TASK_SECOND, TASK_ONCE, [this](){LOGD(P_EmbUI, println, "AutoSave"); save();} );    // config autosave timer
-        ts.addTask(tAutoSave);
+        tIngress.set(TASK_IMMEDIATE, TASK_FOREVER, [this](){ _ingress_drain(); } );     // runs on each scheduler pass
+        ts.addTask(tIngress);
+
+        tBus.set(EMBUI_BUS_DRAIN_MS * TASK_MILLISECOND, TASK_FOREVER, [this](){ _bus_drain(); } );
+        ts.addTask(tBus);
 }
 
 EmbUI::~EmbUI(){
-    ts.deleteTask(tAutoSave);
+    ts.deleteTask(tIngress);
+    ts.deleteTask(tBus);
     ts.deleteTask(tHouseKeeper);
     delete tValPublisher;
     delete tMqttReconnector;
@@ -141,7 +251,13 @@ void EmbUI::begin(){
         }
     }
 
-    load();                 // load embui's config from json file
+    blobs.map();            // optional read-only assets partition
+
+    // load embui's config from json file
+    if (load())
+        save();             // migrate config written by previous versions or in other format, no-op if it is up to date
+    else
+        LOGW(P_EmbUI, println, "config was not loaded, file is left as is");
 
     LOGD(P_EmbUI, print, "UI CONFIG: ");
     LOG_CALL(serializeJson(_cfg, EMBUI_DEBUG_PORT));
@@ -166,6 +282,9 @@ void EmbUI::begin(){
 
     wifi->init();
     
+    // WebSocket egress queues are drained from EmbUI's task
+    WSEgress::getInstance().begin();
+
     // set WebSocket event handler
     ws.onEvent(onWsEvent);
     server.addHandler(&ws);
@@ -180,6 +299,10 @@ void EmbUI::begin(){
     // register system menu handlers
     basicui::register_handlers();
 
+    // start processing incoming messages
+    tIngress.enable();
+    tBus.enable();
+
     setPubInterval(EMBUI_PUB_PERIOD);
 
     tHouseKeeper.set(TASK_SECOND, TASK_FOREVER, [this](){
@@ -212,6 +335,7 @@ void EmbUI::post(JsonObjectConst data){
 
     JsonVariantConst jv(data[P_data]);
     Interface interf(&feeders);
+    interf.json_frame_streaming(true);
     if (feeders.available()){
         // echo back injected data to all available feeders IF request 'data' object is not empty
         if (jv.is<JsonObjectConst>() || jv.is<JsonArrayConst>()){
@@ -232,20 +356,111 @@ void EmbUI::post(JsonObjectConst data){
     action.exec(&interf, jv, act);
 }
 
-void EmbUI::send_pub(){
-    if (mqttAvailable()) _mqtt_pub_sys_status();
+bool EmbUI::ingress(const char* data, size_t len, const char* action, bool msgpack){
+    auto m = _ingress.acquire();
+    if (!m){
+        ++_ingress_drops;
+        LOGW(P_EmbUI, println, "ingress queue is full, msg dropped");
+        return false;
+    }
+
+    // deserialize via copy to prevent dangling pointers in action()'s
+    DeserializationError error = msgpack ? deserializeMsgPack(m->doc, data, len) : deserializeJson(m->doc, data, len);
+    if (error){
+        LOGE(P_EmbUI, printf, "ingress msg deserialization err: %d\n", error.code());
+        m->doc.clear();
+        return false;
+    }
+
+    if (action)
+        m->doc[P_action] = std::string(action);    // set action identifier, copied since caller's string does not outlive the call
+
+    m->ts = esp_timer_get_time();
+    _ingress.commit();
+    return true;
+}
+
+void EmbUI::_ingress_drain(){
+    // process only messages that are already in queue, new arrivals will wait for the next pass
+    for (size_t cnt = _ingress.size(); cnt; --cnt){
+        auto m = _ingress.front();
+        post(m->doc.as<JsonObjectConst>());
+
+        _ingress_lat_last = esp_timer_get_time() - m->ts;
+        if (_ingress_lat_last > _ingress_lat_max)
+            _ingress_lat_max = _ingress_lat_last;
+        ++_ingress_processed;
+        LOGV(P_EmbUI, printf, "post latency:%u us, queue depth:%u\n", _ingress_lat_last, _ingress.size());
+
+        m->doc.clear();
+        _ingress.pop();
+    }
+}
+
+void EmbUI::_bus_drain(){
+    if (!bus.size()) return;
+    JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::misc));
+    if (!bus.drain(doc.to<JsonObject>()) || !feeders.available()) return;
+
+    Interface interf(&feeders);
+    // values that were not changed since last publish are skipped
+    interf.json_frame_value_delta(true);
+    interf.json_frame_value();
+    for (JsonPairConst kv : doc.as<JsonObjectConst>())
+        interf.value(kv.key().c_str(), kv.value());
+    interf.json_frame_flush();
+}
+
+EmbUI::ingress_stat_t EmbUI::ingressStats() const {
+    return { _ingress.size(), _ingress_processed, _ingress_drops.load(), _ingress_lat_last, _ingress_lat_max };
+}
+
+void EmbUI::send_pub(bool sys_status){
+    if (sys_status && mqttAvailable()) _mqtt_pub_sys_status();
     if (!ws.count()) return;
     Interface interf(&ws);     // only websocket publish!
+    // system status values that were not changed since last publish are skipped
+    interf.json_frame_value_delta(true);
     basicui::embuistatus(&interf);
+    interf.json_frame_value_delta(false);
     action.exec(&interf, {}, A_publish);   // call user-callback for publishing task
 }
 
 void EmbUI::handle(){
+    uint32_t t = micros();
     ts.execute();           // run task scheduler
 // FTP server
 #ifndef EMBUI_NOFTP
     ftp_loop();
 #endif
+    t = micros() - t;
+    if (t > _loop_max) _loop_max = t;
+    size_t b = t ? 32 - __builtin_clz(t) : 0;
+    ++_loop_hist[std::min(b, std::size(_loop_hist) - 1)];
+}
+
+EmbUI::loop_stat_t EmbUI::loopStats() const {
+    loop_stat_t s{0, 0, 0, 0, _loop_max};
+    for (auto c : _loop_hist) s.ticks += c;
+    if (!s.ticks) return s;
+    // percentile of ticks that fit into bucket's upper bound
+    auto pct = [this, &s](uint32_t p){
+        uint64_t lim = static_cast<uint64_t>(s.ticks) * p / 100, cnt{0};
+        for (size_t b = 0; b != std::size(_loop_hist); ++b){
+            cnt += _loop_hist[b];
+            if (cnt > lim || cnt == s.ticks) return std::min(static_cast<uint32_t>((1ULL << b) - 1), _loop_max);
+        }
+        return _loop_max;
+    };
+    s.p50 = pct(50);
+    s.p90 = pct(90);
+    s.p99 = pct(99);
+    return s;
+}
+
+void EmbUI::loopStatsReset(){
+    std::fill(std::begin(_loop_hist), std::end(_loop_hist), 0);
+    _loop_max = 0;
 }
 
 /**
@@ -266,18 +481,22 @@ void EmbUI::setPubInterval(uint16_t _t){
 }
 
 /**
- * @brief - restart config autosave timer
+ * @brief - mark config dirty for persistence manager
  * each call postpones cfg write to flash
  */
 void EmbUI::autosave(bool force){
-    if (force){
-        tAutoSave.disable();
-        save();
-    } else {
-        tAutoSave.restartDelayed();
-    }
+    // config has been changed, cached pages might be outdated
+    FrameCache::getInstance().invalidate();
+    _cfg_dirty();
+    if (force)
+        PersistManager::getInstance().flush(EMBUI_cfgfile);
 };
 
+void EmbUI::_cfg_dirty(){
+    // checksum of the saved content is tracked for the default config file only
+    PersistManager::getInstance().dirty(EMBUI_cfgfile, [this](){ return embuifs::serialize2fileAsync(_cfg, EMBUI_cfgfile, &_cfg_crc); }, EMBUI_AUTOSAVE_TIMEOUT * 1000);
+}
+
 /**
  * @brief get/set device hosname
  * if hostname has not been set or empty returns autogenerated __IDPREFIX-[mac_id] hostname
@@ -307,8 +526,8 @@ const char* EmbUI::hostname(const char* name){
     else
         _cfg.remove(V_hostname);
 
-    // save config
-    save();
+    // config is written by persistence manager, pending write is flushed on reboot
+    autosave();
     return hostname();
 };
 
@@ -353,21 +572,38 @@ void EmbUI::publish_language(Interface *interf){
 }
 
 void EmbUI::save(const char *cfg){
-    embuifs::serialize2file(_cfg, cfg ? cfg : EMBUI_cfgfile);
-    LOGD(P_EmbUI, println, "Save config file");
+    if (cfg){
+        embuifs::serialize2fileAtomic(_cfg, cfg);
+        return;
+    }
+    // default config goes through persistence manager, so that it's writes are accounted
+    _cfg_dirty();
+    if (PersistManager::getInstance().flush(EMBUI_cfgfile))
+        LOGD(P_EmbUI, println, "Save config file");
 }
 
-void EmbUI::load(const char *cfgfile){
-    LOGD(P_EmbUI, println, "Load config file");
-    auto err = embuifs::deserializeFile(_cfg, cfgfile ? cfgfile : EMBUI_cfgfile);
-    if (err.code() != DeserializationError::Code::Ok || _cfg.isNull()){
+bool EmbUI::load(const char *cfgfile){
+    int64_t t = esp_timer_get_time();
+    auto err = embuifs::deserializeFileAtomic(_cfg, cfgfile ? cfgfile : EMBUI_cfgfile, cfgfile ? nullptr : &_cfg_crc);
+    bool loaded = err.code() == DeserializationError::Code::Ok && !_cfg.isNull();
+    if (!loaded){
         _cfg.to<JsonObject>();
     }
+    FrameCache::getInstance().invalidate();
+    LOGD(P_EmbUI, printf, "Load config file: %lu us\n", static_cast<unsigned long>(esp_timer_get_time() - t));
+    return loaded;
 }
 
 void EmbUI::cfgclear(){
     LOGI(P_EmbUI, println, "!CLEAR SYSTEM CONFIG!");
     _cfg.to<JsonObject>();
+    FrameCache::getInstance().invalidate();
+    PersistManager::getInstance().discard(EMBUI_cfgfile);
+#if EMBUI_FS_ASYNC
+    // a queued background write would bring the file back
+    FSWriter::getInstance().sync(EMBUI_cfgfile);
+#endif
+    _cfg_crc = 0;
     LittleFS.remove(EMBUI_cfgfile);
     // wipe NVS entries
     esp_err_t err;
@@ -378,52 +614,172 @@ void EmbUI::cfgclear(){
 
 
 
+template <typename Iter, typename F>
+void ActionHandler::_trie_collect(const trie_node_t* node, Iter begin, Iter end, F&& collect){
+    // a mask must be shorter than the action, i.e. "foo_*" does not match "foo_"
+    for (; begin != end; ++begin){
+        for (auto h : node->handlers)
+            collect(h);
+
+        auto i = std::find_if(node->children.cbegin(), node->children.cend(), [c = *begin](const trie_node_t &n){ return n.c == c; });
+        if (i == node->children.cend())
+            return;
+        node = &(*i);
+    }
+}
+
+std::vector<ActionHandler::section_handler_t*>* ActionHandler::_bucket(const char* id, bool create){
+    std::string_view key(id);
+
+    // exact name
+    if (key.empty() || ( !std::char_traits<char>::eq(key.back(), 0x2a) && !std::char_traits<char>::eq(key.front(), 0x2a) )){       // 0x2a  == '*'
+        action_id_t h = hash_djb2a(key);
+        if (create)
+            return &_exact[h];
+        auto i = _exact.find(h);
+        return i == _exact.end() ? nullptr : &i->second;
+    }
+
+    trie_node_t *node;
+    if (std::char_traits<char>::eq(key.back(), 0x2a)){
+        // "prefix_*" mask
+        key.remove_suffix(1);
+        node = &_prefix;
+    } else {
+        // "*_suffix" mask, walk the key backwards
+        key.remove_prefix(1);
+        node = &_suffix;
+    }
+
+    auto walk = [&node, create](char c) -> bool {
+        auto i = std::find_if(node->children.begin(), node->children.end(), [c](const trie_node_t &n){ return n.c == c; });
+        if (i != node->children.end()){
+            node = &(*i);
+            return true;
+        }
+        if (!create) return false;
+        node = &node->children.emplace_back(c);
+        return true;
+    };
+
+    if (node == &_prefix){
+        for (auto c : key)
+            if (!walk(c)) return nullptr;
+    } else {
+        for (auto c = key.crbegin(); c != key.crend(); ++c)
+            if (!walk(*c)) return nullptr;
+    }
+
+    return &node->handlers;
+}
+
 void ActionHandler::add(const char* id, const embui_cb_t& callback){
     if (!id) return;
-    actions.emplace_back(id, callback);
+    actions.emplace_back(section_handler_t{id, callback, _seq++});
+    _bucket(id, true)->push_back(&actions.back());
     LOGD(P_EmbUI, printf, "action register: %s\n", id);
 }
 
+void ActionHandler::add(action_id_t id, const embui_cb_t& callback){
+    actions.emplace_back(section_handler_t{nullptr, callback, _seq++});
+    _exact[id].push_back(&actions.back());
+    LOGD(P_EmbUI, printf, "action register: #%lx\n", id);
+}
+
+void ActionHandler::add_async(const char* id, const embui_async_cb_t& work, const embui_done_cb_t& done){
+    add(id, [work, done](Interface *interf, JsonVariantConst data, const char* action){
+        WorkerPool::getInstance().submit(interf, action, data, work, done);
+    });
+}
+
 void ActionHandler::replace(const char* id, const embui_cb_t& callback){
-    auto i = std::find_if(actions.begin(), actions.end(), [&id](const section_handler_t &arg) { return std::string_view(arg.action).compare(id) == 0; } );
+    if (!id) return;
+    auto b = _bucket(id, false);
+    if (!b)
+        return add(id, callback);
 
-    if ( i == actions.end() )
+    // bucket might also hold handlers with colliding hash or registered by id, match on name
+    auto h = std::find_if(b->begin(), b->end(), [id](const section_handler_t* p){ return p->action && !std::strcmp(p->action, id); });
+    if (h == b->end())
         return add(id, callback);
-    
-    i->cb = callback;
+
+    (*h)->cb = callback;
 }
 
 void ActionHandler::remove(const char* id){
-    actions.remove_if([&id](const section_handler_t &arg) { return std::string_view(arg.action).compare(id) == 0; });
+    if (!id) return;
+    auto b = _bucket(id, false);
+    if (!b) return;
+
+    // unlink matched handlers from the bucket first, then destroy them
+    auto i = std::stable_partition(b->begin(), b->end(), [id](const section_handler_t* h){ return !h->action || std::strcmp(h->action, id); });
+    std::vector<section_handler_t*> matched(i, b->end());
+    b->erase(i, b->end());
+    actions.remove_if([&matched](const section_handler_t &arg) { return std::find(matched.cbegin(), matched.cend(), &arg) != matched.cend(); });
+    if (!b->empty()) return;
+
+    std::string_view key(id);
+    if (!key.empty() && !std::char_traits<char>::eq(key.back(), 0x2a) && !std::char_traits<char>::eq(key.front(), 0x2a))
+        _exact.erase(hash_djb2a(key));
+}
+
+void ActionHandler::remove(action_id_t id){
+    auto i = _exact.find(id);
+    if (i == _exact.end()) return;
+    auto &b = i->second;
+    actions.remove_if([&b](const section_handler_t &arg) { return std::find(b.cbegin(), b.cend(), &arg) != b.cend(); });
+    _exact.erase(i);
+}
+
+void ActionHandler::clear(){
+    _exact.clear();
+    _prefix.children.clear();
+    _prefix.handlers.clear();
+    _suffix.children.clear();
+    _suffix.handlers.clear();
+    actions.clear();
 }
 
 size_t ActionHandler::exec(Interface *interf, JsonVariantConst data, const char* action){
-    size_t cnt{0};
-    if (!action) return cnt;      // return if action is empty string
+    if (!action) return 0;      // return if action is empty string
     std::string_view a(action);
 
-    for (const auto& i : actions){
-        LOGV(P_EmbUI, printf, "Check action:%s against:%s\n", action, i.action);
-        std::string_view item(i.action);
-        if (a.length() < item.length()) continue;  // skip handlers with longer names, obviously a mismatch
+    // collect matched handlers, usually there are just a few of it, so keep it on stack
+    section_handler_t* stack_buff[ACTION_MATCH_BUFF];
+    std::vector<section_handler_t*> heap_buff;
+    size_t cnt{0};
+
+    auto collect = [&](section_handler_t* h){
+        if (cnt < ACTION_MATCH_BUFF)
+            stack_buff[cnt] = h;
+        else
+            heap_buff.push_back(h);
+        ++cnt;
+    };
 
-        // check if action has a wildcard suffix "*" and it does not match
-        if (std::char_traits<char>::eq(item.back(), 0x2a) && !starts_with(a, item.substr(0, item.size()-1) ))       // 0x2a  == '*'
-            continue;
+    // action name is hashed once, handlers registered with a string name are compared to rule out hash collisions
+    auto e = _exact.find(hash_djb2a(a));
+    if (e != _exact.end())
+        for (auto h : e->second)
+            if (!h->action || a == h->action)
+                collect(h);
 
-        // check if action has a wildcard prefix "*" and it does not match
-        if (std::char_traits<char>::eq(item.front(), 0x2a) && !ends_with(a, item.substr(1) ))
-            continue;
+    _trie_collect(&_prefix, a.cbegin(), a.cend(), collect);
+    _trie_collect(&_suffix, a.crbegin(), a.crend(), collect);
 
-        if (!std::char_traits<char>::eq(item.back(), 0x2a) &&
-            !std::char_traits<char>::eq(item.front(), 0x2a) &&
-            a.compare(item) != 0
-        ) continue;     // full string compare
+    if (!cnt) return cnt;
 
+    auto item = [&](size_t i) -> section_handler_t*& { return i < ACTION_MATCH_BUFF ? stack_buff[i] : heap_buff[i - ACTION_MATCH_BUFF]; };
+
+    // restore registration order
+    for (size_t i = 1; i < cnt; ++i)
+        for (size_t j = i; j && item(j - 1)->seq > item(j)->seq; --j)
+            std::swap(item(j - 1), item(j));
+
+    for (size_t i = 0; i != cnt; ++i){
         // execute action callback
-        LOGI(P_EmbUI, printf, "exec act:%s hndlr:%s\n", action, item.data());
-        i.cb(interf, data, action);
-        ++cnt;
+        LOGI(P_EmbUI, printf, "exec act:%s hndlr:%s\n", action, item(i)->action ? item(i)->action : "#");
+        item(i)->cb(interf, data, action);
     }
 
     return cnt;
@@ -7,7 +7,17 @@
 
 #include <Arduino.h>
 #include <list>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include "embuifs.hpp"
+#include "embuifs_blob.hpp"
+#include "embui_action.hpp"
+#include "embui_bus.hpp"
+#include "embui_queue.hpp"
+#include "embui_workers.hpp"
+#include "embui_persist.hpp"
+#include "embui_fswriter.hpp"
 #include "ts.h"
 #include "timeProcessor.h"
 #include "embui_wifi.hpp"
@@ -35,6 +45,14 @@ using embui_lang_cb_t = std::function< void (const char* lang)>;
  * @brief a class that manages action handlers
  * add/remove/search, etc...
  * 
+ * Handlers are indexed on registration, so that lookup cost does not depend on the number of registered actions:
+ *  - exact action names are kept in a hash table
+ *  - prefix masks, i.e. "foo_*", are kept in a char trie
+ *  - suffix masks, i.e. "*_foo", are kept in a char trie with reversed keys
+ * 
+ * Exact names are indexed by a hash of the name, so handlers could also be registered with
+ * a compile-time hashed id, i.e. "sys_ntwrk_wifi"_sh, and receive a decoded payload struct, see embui_action.hpp
+ * 
  */
 class ActionHandler {
     /**
@@ -43,26 +61,105 @@ class ActionHandler {
      * 
      */
     struct section_handler_t {
-        // action id
+        // action id, nullptr for handlers registered with a hashed id
         const char* action;
         // callback function
         embui_cb_t cb;
+        // registration sequence number, used to execute matched callbacks in the order they were added
+        uint32_t seq;
+    };
+
+    /**
+     * @brief a node of char trie used to index wildcard masks
+     * 
+     */
+    struct trie_node_t {
+        char c;
+        std::vector<trie_node_t> children;
+        // handlers with a mask that terminates on this node
+        std::vector<section_handler_t*> handlers;
+        explicit trie_node_t(char ch = 0) : c(ch) {}
     };
 
     // a list of action handlers
     std::list<section_handler_t> actions;
 
+    // index for actions with exact names, keyed with name's hash
+    std::unordered_map<action_id_t, std::vector<section_handler_t*>> _exact;
+    // index for "prefix_*" masks
+    trie_node_t _prefix;
+    // index for "*_suffix" masks (keys are reversed)
+    trie_node_t _suffix;
+    // registration sequence counter
+    uint32_t _seq{0};
+
+    /**
+     * @brief find index bucket that holds handlers for the specified id
+     * 
+     * @param id action name or mask
+     * @param create - if true, a missing bucket will be created
+     * @return std::vector<section_handler_t*>* pointer to a bucket or nullptr if bucket does not exist
+     */
+    std::vector<section_handler_t*>* _bucket(const char* id, bool create);
+
+    // walk down the trie with the chars of the action and collect handlers for all masks shorter than action itself
+    template <typename Iter, typename F>
+    static void _trie_collect(const trie_node_t* node, Iter begin, Iter end, F&& collect);
+
 public:
     /**
      * @brief add ui action handler
      * 
      * @param id action name (note: pointer MUST be valid for the whole lifetime of ActionHandler instance,
      *              the string it points to won't be deep-copied )
+     *              could be a mask with a wildcard prefix or suffix, i.e. "*_foo" or "foo_*",
+     *              a mask with wildcards on both ends is treated as a prefix mask
      * @param response callback function
      * 
      */
     void add(const char* id, const embui_cb_t& callback);
 
+    /**
+     * @brief add ui action handler with hashed action name
+     * 
+     * @param id action name's hash, i.e. "my_action"_sh or hash_djb2a(A_my_action)
+     * @param callback callback function
+     */
+    void add(action_id_t id, const embui_cb_t& callback);
+
+    /**
+     * @brief add ui action handler with a typed payload
+     * post's data object is decoded into T before callback is executed, callback is not executed if data is not an object, i.e.
+     *  embui.action.add<wifi_cfg_t>("sys_ntwrk_wifi"_sh, [](Interface *interf, const wifi_cfg_t& cfg){ ... });
+     * 
+     * @tparam T payload struct with 'fields' descriptors, see embui_action::decode()
+     * @param id action name's hash
+     * @param callback callback function
+     */
+    template <typename T>
+    void add(action_id_t id, std::function< void (Interface *interf, const T& payload)> callback){
+        add(id, [callback](Interface *interf, JsonVariantConst data, const char* action){
+            if (!data.is<JsonObjectConst>()) return;
+            T payload{};
+            embui_action::decode(data, payload);
+            callback(interf, payload);
+        });
+    }
+
+    /**
+     * @brief add ui action handler that runs on a worker task
+     * action's data is copied and work function is executed on WorkerPool, so it must not use Interface.
+     * Job's progress is published as a value with action's name as a key, completion callback
+     * is executed on EmbUI's task with an Interface to all feeders once work is done
+     *  embui.action.add_async("scan", [](AsyncJob& job){ ...; job.progress(50); ...; job.result["files"] = n; },
+     *                                 [](Interface *interf, AsyncJob& job){ interf->json_frame_value(job.result); interf->json_frame_flush(); });
+     *
+     * @param id action name
+     * @param work work function
+     * @param done completion callback, optional
+     */
+    void add_async(const char* id, const embui_async_cb_t& work, const embui_done_cb_t& done = nullptr);
+
     /**
      * @brief replace callback for specified id
      * if action with specified id does not exist in the list, a new action callback will be added ( like via add() )
@@ -79,14 +176,23 @@ public:
      */
     void remove(const char* id);
 
+    /**
+     * @brief remove all handlers for hashed action name
+     * handlers registered with a string name that has same hash are also removed
+     * 
+     * @param id action name's hash
+     */
+    void remove(action_id_t id);
+
     /**
      * @brief remove all registered actions
      * 
      */
-    void clear(){ actions.clear(); };
+    void clear();
 
     /**
      * @brief lookup and execute registered callbacks for the specified action
+     * all matching callbacks are executed in the order they were registered
      * 
      * @return number of callbacks executed, 0 - if no callback were registered for such action
      */
@@ -115,7 +221,8 @@ public:
 
 class EmbUI
 {
-    JsonDocument _cfg;                        // system config
+    JsonDocument _cfg{embui_mem::allocator(embui_mem::subsys_t::config)};   // system config
+    uint32_t _cfg_crc{0};                     // checksum of the last saved/loaded config content
 
   public:
     EmbUI();
@@ -137,6 +244,18 @@ class EmbUI
      */
     FrameSendChain feeders;
 
+    /**
+     * @brief value bus, values posted from any task are published to feeders from EmbUI's task
+     * see ValueBus
+     */
+    ValueBus bus;
+
+    /**
+     * @brief read-only blobs pack mapped from EMBUIFS_BLOB_PARTITION flash partition, if present
+     * blobs are served over http in place of LittleFS files with same names, could be parsed with embuifs::deserializeBlob()
+     */
+    embuifs::BlobPack blobs;
+
     /**
      * @brief EmbUI initialization
      * load configuration from FS, setup WiFi, obtain system date/time, etc...
@@ -162,12 +281,13 @@ class EmbUI
 
     /***  config operations ***/
     void save(const char *cfg = nullptr);
-    void load(const char *cfgfile = nullptr);   // if null, than default cfg file is used
+    bool load(const char *cfgfile = nullptr);   // if null, than default cfg file is used, returns false if file was not loaded
     void cfgclear();                            // clear current config, both in RAM and file
 
     /**
-     * @brief - initialize/restart config autosave timer
-     * each call postpones cfg write to flash
+     * @brief - mark config dirty, it is written to flash by PersistManager
+     * each call postpones cfg write to flash for EMBUI_AUTOSAVE_TIMEOUT
+     * @param force - write config right away
      */
     void autosave(bool force = false);
 
@@ -178,6 +298,63 @@ class EmbUI
      */
     void post(JsonObjectConst data);
 
+    /**
+     * @brief ingress queue statistics
+     * 
+     */
+    struct ingress_stat_t {
+        // number of messages waiting in queue
+        size_t depth;
+        // number of processed messages
+        uint32_t processed;
+        // number of messages dropped due to queue overflow
+        uint32_t drops;
+        // post latency from enqueueing to completion of action handlers, us
+        uint32_t latency_last;
+        uint32_t latency_max;
+    };
+
+    /**
+     * @brief enqueue post'ed json data for processing in loop() context
+     * used by WebSocket/MQTT handlers running in async tcp task. Data is deserialized into a queue slot
+     * and will be passed to post() on the next handle() tick. Slot's memory is allocated on first use and reused,
+     * messages that do not fit into EMBUI_INGRESS_SLOT_SIZE take the rest from heap
+     * 
+     * @param data - json string
+     * @param len - string length
+     * @param action - if not null, would be set as an action for the post'ed data
+     * @param msgpack - data is MessagePack encoded
+     * @return true if data was enqueued, false if queue is full or data can't be deserialized
+     */
+    bool ingress(const char* data, size_t len, const char* action = nullptr, bool msgpack = false);
+
+    /**
+     * @brief get ingress queue statistics
+     */
+    ingress_stat_t ingressStats() const;
+
+    /**
+     * @brief handle() tick duration statistics
+     * percentiles are estimated with a log2 histogram, reported value is an upper bound of the bucket
+     */
+    struct loop_stat_t {
+        // number of ticks measured
+        uint32_t ticks;
+        // tick duration, us
+        uint32_t p50;
+        uint32_t p90;
+        uint32_t p99;
+        uint32_t max;
+    };
+
+    /**
+     * @brief get handle() tick duration statistics
+     */
+    loop_stat_t loopStats() const;
+
+    // reset tick duration statistics
+    void loopStatsReset();
+
     /**
      * @brief Set EmbUI's language
      * 
@@ -219,8 +396,9 @@ class EmbUI
 
     /**
      * Publish status data to the WebUI
+     * @param sys_status also publish system status to MQTT, stats are owned by EmbUI's task, so it must be called from that task
      */
-    void send_pub();
+    void send_pub(bool sys_status = true);
 
     // call-backs
 
@@ -323,6 +501,16 @@ class EmbUI
      */
     void publish(const char* topic, const JsonVariantConst data, bool retained = false);
 
+    /**
+     * @brief publish pre-serialized data to MQTT ~ topic
+     * 
+     * @param topic 
+     * @param payload - raw payload bytes
+     * @param length - payload length
+     * @param retained - flag
+     */
+    void publish(const char* topic, const uint8_t* payload, size_t length, bool retained = false);
+
 
     /**
      * @brief publish data to MQTT ~ topic
@@ -350,14 +538,37 @@ private:
     embui_lang_cb_t _lang_cb{nullptr};
 
 
-    // WS Message queue
+    // incoming messages queue
+    struct ingress_msg_t {
+        // slot's memory is kept and reused for the next messages
+        embui_mem::SlotAllocator alloc{embui_mem::allocator(embui_mem::subsys_t::ingress), EMBUI_INGRESS_SLOT_SIZE};
+        JsonDocument doc{&alloc};
+        // enqueue timestamp, us
+        int64_t ts;
+    };
+    SPSCQueue<ingress_msg_t, EMBUI_INGRESS_QUEUE_SIZE> _ingress;
+    std::atomic<uint32_t> _ingress_drops{0};
+    uint32_t _ingress_processed{0};
+    uint32_t _ingress_lat_last{0};
+    uint32_t _ingress_lat_max{0};
+    // handle() tick duration histogram, bucket n counts ticks of [2^(n-1), 2^n) us
+    uint32_t _loop_hist[24]{};
+    uint32_t _loop_max{0};
+
+    // process messages from ingress queue
+    void _ingress_drain();
 
+    // publish values posted to value bus
+    void _bus_drain();
 
+    // register config with persistence manager
+    void _cfg_dirty();
 
     // Scheduler tasks
     Task *tValPublisher = nullptr;    // Status data publisher
     Task tHouseKeeper;      // Maintenance task, runs every second
-    Task tAutoSave;         // config autosave timer
+    Task tIngress;          // ingress queue processor
+    Task tBus;              // value bus processor
 
     // external handler for 404 not found 
     asyncsrv_callback_t cb_not_found = nullptr;
@@ -480,6 +691,19 @@ public:
      * @param data object to publish
      */
     virtual void send(const JsonVariantConst& data) override;
+
+    /**
+     * @brief publish pre-serialized "interface" and "xload" packets to EmbUI's topic '~/pub/interface'
+     * 
+     * @param data serialized frame
+     */
+    void send(const AsyncWebSocketSharedBuffer& data) override;
+
+    /**
+     * @brief "interface" and "xload" packets are published as-is, so could be taken pre-serialized,
+     * "value" packets are transformed to publish only it's block
+     */
+    bool accepts_raw(const JsonVariantConst& data) const override { return data[P_pkg] == P_interface || data[P_pkg] == P_xload; }
 };
 
 
@@ -1,6 +1,7 @@
 #include "basicui.h"
 #include "ftpsrv.h"
 #include "EmbUI.h"
+#include "embui_framecache.hpp"
 #include "nvs_handle.hpp"
 
 uint8_t lang = 0;
@@ -26,7 +27,7 @@ void register_handlers(){
     embui.action.add(A_sys_language, set_language);                 // смена языка интерфейса
     embui.action.add(A_sys_reboot, set_sys_reboot);                 // ESP reboot action
     embui.action.add(A_sys_timeoptions, set_settings_time);         // установки даты/времени
-    embui.action.add(A_sys_ntwrk_wifi, set_settings_wifi);          // обработка настроек WiFi Client
+    embui.action.add<wifi_client_cfg_t>(hash_djb2a(A_sys_ntwrk_wifi), set_wifi_client);   // обработка настроек WiFi Client
     embui.action.add(A_sys_ntwrk_wifiap, set_settings_wifiAP);      // обработка настроек WiFi AP
     embui.action.add(A_sys_ntwrk_mqtt, set_settings_mqtt);          // обработка настроек MQTT
 #ifndef EMBUI_NOFTP
@@ -95,30 +96,49 @@ void show_uipage(Interface *interf, JsonVariantConst data, const char* action){
     page idx = static_cast<page>(data.as<int>());
     LOGD("basicui", printf, "page:%d\n", idx);
 
+    auto &cache = FrameCache::getInstance();
+    bool cacheable;
     switch (idx){
-        case page::main :    // main page stub
-            page_main(interf);
+        // network and time pages show live device state
+        case page::network :
+        case page::datetime :
+            cacheable = false;
             break;
-        case page::settings :   // general settings page
-            page_system_settings(interf, {}, NULL);
+        // main and settings pages run user's settings block
+        case page::main :
+        case page::settings :
+            cacheable = cache.cacheable(A_ui_blk_usersettings);
             break;
-        case page::network :    // WiFi network setup section
-            page_settings_netw(interf, {}, NULL);
-            break;
-        case page::datetime :   // time setup section
-            page_settings_time(interf);
-            break;
-        case page::mqtt :       // MQTT setup section
-            page_settings_mqtt(interf);
-            break;
-        case page::ftp :        // FTP server setup section
-            page_settings_ftp(interf);
-            break;
-        case page::syssetup :   // system setup section
-            page_settings_sys(interf);
-            break;
-        default:;   // do not show anything
+        // the rest are built from config only
+        default:
+            cacheable = true;
     }
+    cache.build(interf, cacheable ? FrameCache::key(A_sys_page, data) : 0, [interf, idx](){
+        switch (idx){
+            case page::main :    // main page stub
+                page_main(interf);
+                break;
+            case page::settings :   // general settings page
+                page_system_settings(interf, {}, NULL);
+                break;
+            case page::network :    // WiFi network setup section
+                page_settings_netw(interf, {}, NULL);
+                break;
+            case page::datetime :   // time setup section
+                page_settings_time(interf);
+                break;
+            case page::mqtt :       // MQTT setup section
+                page_settings_mqtt(interf);
+                break;
+            case page::ftp :        // FTP server setup section
+                page_settings_ftp(interf);
+                break;
+            case page::syssetup :   // system setup section
+                page_settings_sys(interf);
+                break;
+            default:;   // do not show anything
+        }
+    });
 }
 
 /**
@@ -217,8 +237,14 @@ void page_settings_sys(Interface *interf){
 void set_settings_wifi(Interface *interf, JsonVariantConst data, const char* action){
     if (!data.is<JsonObjectConst>()) return;
 
+    wifi_client_cfg_t cfg;
+    embui_action::decode(data, cfg);
+    set_wifi_client(interf, cfg);
+}
+
+void set_wifi_client(Interface *interf, const wifi_client_cfg_t& cfg){
     embui.getConfig().remove(V_APonly);             // remove "force AP mode" parameter when attempting connection to external AP
-    embui.wifi->connect(data[V_WCSSID].as<const char*>(), data[V_WCPASS].as<const char*>());
+    embui.wifi->connect(cfg.ssid, cfg.pwd);
 
     page_system_settings(interf, {});               // display "settings" page
     embui.autosave();
@@ -435,7 +461,7 @@ void embuistatus(Interface *interf){
 }
 
 void set_sys_reboot(Interface *interf, JsonVariantConst data, const char* action){
-    Task *t = new Task(TASK_SECOND*5, TASK_ONCE, nullptr, &ts, false, nullptr, [](){ LOG(println, "Rebooting..."); ESP.restart(); });
+    Task *t = new Task(TASK_SECOND*5, TASK_ONCE, nullptr, &ts, false, nullptr, [](){ LOG(println, "Rebooting..."); PersistManager::getInstance().flush(); ESP.restart(); });
     t->enableDelayed();
     if(interf){
         page_settings_sys(interf);
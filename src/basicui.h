@@ -4,6 +4,7 @@
 #pragma once
 
 #include "ui.h"
+#include "embui_action.hpp"
 
 extern uint8_t lang;
 
@@ -30,6 +31,13 @@ namespace basicui {
         syssetup
     };
 
+  // WiFi Client settings payload
+  struct wifi_client_cfg_t {
+    const char* ssid{nullptr};
+    const char* pwd{nullptr};
+    static constexpr auto fields = std::make_tuple(embui_action::field(V_WCSSID, &wifi_client_cfg_t::ssid), embui_action::field(V_WCPASS, &wifi_client_cfg_t::pwd));
+  };
+
   /**
    * register handlers for system actions and setup pages
    * 
@@ -59,6 +67,7 @@ namespace basicui {
    */
   void page_system_settings(Interface *interf, JsonVariantConst data, const char* action = NULL);
   void set_settings_wifi(Interface *interf, JsonVariantConst data, const char* action = NULL);
+  void set_wifi_client(Interface *interf, const wifi_client_cfg_t& cfg);
   void set_settings_wifiAP(Interface *interf, JsonVariantConst data, const char* action = NULL);
   void set_settings_mqtt(Interface *interf, JsonVariantConst data, const char* action = NULL);
   void set_settings_time(Interface *interf, JsonVariantConst data, const char* action = NULL);
@@ -0,0 +1,73 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include "traits.hpp"
+
+// action identifier, a hash of action's name, i.e. "sys_ntwrk_wifi"_sh or hash_djb2a(A_sys_ntwrk_wifi)
+using action_id_t = decltype(hash_djb2a(std::string_view()));
+
+/**
+ * @brief typed action payloads
+ * a handler could declare a payload struct, post's data object is decoded into it in a single pass,
+ * each data key is hashed once and matched against struct's field descriptors
+ */
+namespace embui_action {
+
+// payload field descriptor
+template <typename T, typename M>
+struct field_t {
+    // hash of data key
+    action_id_t key;
+    M T::*member;
+};
+
+/**
+ * @brief bind a data key to a payload struct member
+ *
+ * @param key data key
+ * @param member pointer to struct member
+ */
+template <typename T, typename M>
+constexpr field_t<T, M> field(std::string_view key, M T::*member){ return { hash_djb2a(key), member }; }
+
+/**
+ * @brief decode post's data object into a payload struct
+ * T must declare a static constexpr 'fields' tuple of field() descriptors, i.e.
+ *  struct wifi_t {
+ *      const char* ssid{nullptr};
+ *      const char* pwd{nullptr};
+ *      static constexpr auto fields = std::make_tuple(embui_action::field(V_WCSSID, &wifi_t::ssid), embui_action::field(V_WCPASS, &wifi_t::pwd));
+ *  };
+ * members are converted with JsonVariantConst::as<member type>(), members missing in data keep their values.
+ * const char* members point into data object, so those are valid only while the handler is running
+ *
+ * @param data post's data object
+ * @param dst payload struct
+ * @return size_t number of decoded fields
+ */
+template <typename T>
+size_t decode(JsonVariantConst data, T& dst){
+    size_t cnt{0};
+    for (JsonPairConst kv : data.as<JsonObjectConst>()){
+        action_id_t h = hash_djb2a(std::string_view(kv.key().c_str(), kv.key().size()));
+        std::apply([&](const auto&... f){
+            // first field with a matching key takes the value
+            ( (f.key == h ? (dst.*(f.member) = kv.value().template as< std::remove_reference_t<decltype(dst.*(f.member))> >(), ++cnt, true) : false) || ... );
+        }, T::fields);
+    }
+    return cnt;
+}
+
+} // namespace embui_action
@@ -0,0 +1,36 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include <string>
+#include "embui_bus.hpp"
+
+size_t ValueBus::drain(JsonObject dst){
+    size_t cnt{0};
+    // consume only events that are already in queue, so that busy producers can't stall the consumer
+    for (size_t n = _q.size(); n; --n){
+        event_t *e = _q.front();
+        // the oldest slot is still being filled by producer
+        if (!e) break;
+        JsonVariant v = dst[e->key];
+        switch (e->type){
+            case type_t::integer : v.set(e->i); break;
+            case type_t::uinteger : v.set(e->u); break;
+            case type_t::real : v.set(e->f); break;
+            case type_t::boolean : v.set(e->b); break;
+            // slot is reused, string must be copied, ArduinoJson before 7.3 keeps a const char* by pointer
+            case type_t::string : v.set(std::string(e->s)); break;
+            default : v.set(nullptr);
+        }
+        _q.pop();
+        ++cnt;
+    }
+    _processed += cnt;
+    return cnt;
+}
@@ -0,0 +1,119 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include <ArduinoJson.h>
+#include "embui_queue.hpp"
+#include "embui_defines.h"
+
+/**
+ * @brief value bus for publishing UI values from other tasks
+ * Interface is not thread-safe and must be used from the task that runs EmbUI::handle() only.
+ * Any other task, i.e. a sensor polling task on the other core, could post small value updates to the bus,
+ * posting never allocates or blocks. EmbUI drains the bus periodically and publishes values to all feeders
+ * in a single value frame, values with the same key posted within drain period are coalesced into the latest one.
+ *
+ * Example:
+ *  embui.bus.post("temp", 21.5);
+ *  embui.bus.post("state", "heating");
+ */
+class ValueBus {
+public:
+    enum class type_t : uint8_t {
+        null = 0,
+        integer,
+        uinteger,
+        real,
+        boolean,
+        string
+    };
+
+    struct event_t {
+        // value's key, not copied, must point to a string with static storage, i.e. a literal or a constant
+        const char* key;
+        type_t type;
+        union {
+            int32_t i;
+            uint32_t u;
+            float f;
+            bool b;
+            // string value, truncated to EMBUI_BUS_STR_LEN - 1 chars
+            char s[EMBUI_BUS_STR_LEN];
+        };
+    };
+
+private:
+    MPSCQueue<event_t, EMBUI_BUS_QUEUE_SIZE> _q;
+    std::atomic<uint32_t> _drops{0};
+    uint32_t _processed{0};
+
+public:
+    /**
+     * @brief post a value (could be called from any task)
+     * integer values are kept as 32 bit, floating point values as float
+     *
+     * @param key value's key, must point to a string with static storage
+     * @param value integer, floating point, bool or string value, nullptr string posts null value
+     * @return false if bus queue is full and value was dropped
+     */
+    template <typename T>
+    bool post(const char* key, T value){
+        if (!key) return false;
+        event_t e;
+        e.key = key;
+        if constexpr (std::is_same_v<T, bool>){
+            e.type = type_t::boolean;
+            e.b = value;
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>){
+            e.type = type_t::integer;
+            e.i = static_cast<int32_t>(value);
+        } else if constexpr (std::is_integral_v<T>){
+            e.type = type_t::uinteger;
+            e.u = static_cast<uint32_t>(value);
+        } else if constexpr (std::is_floating_point_v<T>){
+            e.type = type_t::real;
+            e.f = static_cast<float>(value);
+        } else {
+            static_assert(std::is_convertible_v<T, const char*>, "unsupported value type");
+            const char* str = value;
+            if (str){
+                e.type = type_t::string;
+                std::strncpy(e.s, str, EMBUI_BUS_STR_LEN - 1);
+                e.s[EMBUI_BUS_STR_LEN - 1] = 0;
+            } else
+                e.type = type_t::null;
+        }
+        if (_q.push(e)) return true;
+        ++_drops;
+        return false;
+    }
+
+    /**
+     * @brief move posted values to an object (consumer side)
+     * a newer value replaces an older one with the same key, values posted while draining are left for the next call
+     *
+     * @param dst object to put values to
+     * @return size_t number of events consumed
+     */
+    size_t drain(JsonObject dst);
+
+    // number of values waiting in queue
+    size_t size() const { return _q.size(); }
+
+    // number of values dropped due to queue overflow
+    uint32_t drops() const { return _drops; }
+
+    // number of values consumed
+    uint32_t processed() const { return _processed; }
+};
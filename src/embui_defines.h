@@ -49,4 +49,187 @@
 #define EMBUI_MAX_WS_CLIENTS          4
 #endif
 
+// maximum size of a fragmented WebSocket message that could be reassembled, bytes
+#ifndef EMBUI_WS_MAX_MSG_SIZE
+#define EMBUI_WS_MAX_MSG_SIZE         16384
+#endif
+
+// memory budget for WebSocket messages reassembly buffers of all clients, bytes
+#ifndef EMBUI_WS_REASSEMBLY_BUDGET
+#define EMBUI_WS_REASSEMBLY_BUDGET    32768
+#endif
+
+// size of the queue for incoming WebSocket/MQTT posts, must be a power of 2
+#ifndef EMBUI_INGRESS_QUEUE_SIZE
+#define EMBUI_INGRESS_QUEUE_SIZE      8
+#endif
+
+// memory kept by each ingress queue slot for deserialized messages, bytes
+#ifndef EMBUI_INGRESS_SLOT_SIZE
+#define EMBUI_INGRESS_SLOT_SIZE       2048
+#endif
+
+// size of the value bus queue for values published from other tasks, must be a power of 2
+#ifndef EMBUI_BUS_QUEUE_SIZE
+#define EMBUI_BUS_QUEUE_SIZE          64
+#endif
+
+// max length of a string value posted to the value bus, longer strings are truncated
+#ifndef EMBUI_BUS_STR_LEN
+#define EMBUI_BUS_STR_LEN             16
+#endif
+
+// value bus drain period, ms. Values posted within the period are coalesced into a single value frame
+#ifndef EMBUI_BUS_DRAIN_MS
+#define EMBUI_BUS_DRAIN_MS            50
+#endif
+
+// max number of frames handed over to AsyncWebSocket's client queue, the rest are kept in EmbUI's per-client egress queue
+#ifndef EMBUI_WS_CLIENT_INFLIGHT
+#define EMBUI_WS_CLIENT_INFLIGHT      4
+#endif
+
+// per-client egress queue depth, frames
+#ifndef EMBUI_WS_CLIENT_QUEUE
+#define EMBUI_WS_CLIENT_QUEUE         16
+#endif
+
+// egress queues drain interval, ms
+#ifndef EMBUI_WS_EGRESS_DRAIN_MS
+#define EMBUI_WS_EGRESS_DRAIN_MS      20
+#endif
+
+// Interface frame size budget, frames are auto-split into continuation frames when exceeded, 0 - disable
+#ifndef EMBUI_FRAME_BUDGET
+#define EMBUI_FRAME_BUDGET            4096
+#endif
+
+// initial output buffer reservation for streaming Interface frames
+#ifndef EMBUI_STREAM_BUFF_RESERVE
+#define EMBUI_STREAM_BUFF_RESERVE     512
+#endif
+
+// memory limit for cached page frames, bytes, 0 - disable page frames cache
+#ifndef EMBUI_FRAMECACHE_SIZE
+#define EMBUI_FRAMECACHE_SIZE         16384
+#endif
+
+// number of worker tasks for async action handlers
+#ifndef EMBUI_WORKERS
+#define EMBUI_WORKERS                 1
+#endif
+
+// worker task stack size, bytes
+#ifndef EMBUI_WORKER_STACK
+#define EMBUI_WORKER_STACK            4096
+#endif
+
+// core to pin worker tasks to, tskNO_AFFINITY - any core
+#ifndef EMBUI_WORKER_CORE
+#define EMBUI_WORKER_CORE             tskNO_AFFINITY
+#endif
+
+#ifndef EMBUI_WORKER_PRIORITY
+#define EMBUI_WORKER_PRIORITY         1
+#endif
+
+// max number of async jobs waiting for a worker, jobs beyond this are rejected
+#ifndef EMBUI_WORKER_QUEUE
+#define EMBUI_WORKER_QUEUE            8
+#endif
+
+// async jobs progress and completion poll period, ms
+#ifndef EMBUI_WORKER_POLL_MS
+#define EMBUI_WORKER_POLL_MS          100
+#endif
+
+// number of unit states sent per scheduler tick by EmbUI_Unit_Manager::streamUnitsStatuses()
+#ifndef EMBUI_UNITS_STATUS_CHUNK
+#define EMBUI_UNITS_STATUS_CHUNK      16
+#endif
+
+// max length of unit's preset label in presets store, including terminating null
+#ifndef EMBUI_PRESET_LABEL_LEN
+#define EMBUI_PRESET_LABEL_LEN        24
+#endif
+
+// presets store allocates space for records in multiples of this size, so that slightly grown preset is rewritten in place
+#ifndef EMBUI_PRESET_SLACK
+#define EMBUI_PRESET_SLACK            64
+#endif
+
+// write-behind persistence: default debounce delay for dirty objects, ms
+#ifndef EMBUI_PERSIST_DELAY
+#define EMBUI_PERSIST_DELAY           3000
+#endif
+
+// max time an object could stay dirty if it keeps changing, ms
+#ifndef EMBUI_PERSIST_MAX_DELAY
+#define EMBUI_PERSIST_MAX_DELAY       60000
+#endif
+
+// min interval between writes of the same object, ms
+#ifndef EMBUI_PERSIST_MIN_INTERVAL
+#define EMBUI_PERSIST_MIN_INTERVAL    10000
+#endif
+
+// persistence manager poll period, ms
+#ifndef EMBUI_PERSIST_TICK_MS
+#define EMBUI_PERSIST_TICK_MS         1000
+#endif
+
+// write config files from a background task instead of EmbUI's task (1), 0 - write synchronously
+#ifndef EMBUI_FS_ASYNC
+#define EMBUI_FS_ASYNC                1
+#endif
+
+// background FS writer task's stack size, bytes
+#ifndef EMBUI_FSWRITER_STACK
+#define EMBUI_FSWRITER_STACK          4096
+#endif
+
+// core to pin FS writer task to, tskNO_AFFINITY - any core
+#ifndef EMBUI_FSWRITER_CORE
+#define EMBUI_FSWRITER_CORE           tskNO_AFFINITY
+#endif
+
+#ifndef EMBUI_FSWRITER_PRIORITY
+#define EMBUI_FSWRITER_PRIORITY       1
+#endif
+
+// max number of files waiting for background write, writes beyond this are done synchronously
+#ifndef EMBUI_FSWRITER_QUEUE
+#define EMBUI_FSWRITER_QUEUE          8
+#endif
+
+// background writes completion poll period, ms
+#ifndef EMBUI_FSWRITER_POLL_MS
+#define EMBUI_FSWRITER_POLL_MS        50
+#endif
+
+// label of flash data partition holding read-only blobs pack
+#ifndef EMBUIFS_BLOB_PARTITION
+#define EMBUIFS_BLOB_PARTITION        "assets"
+#endif
+
+// max length of blob's name in a pack, including terminating null
+#ifndef EMBUIFS_BLOB_NAME_LEN
+#define EMBUIFS_BLOB_NAME_LEN         48
+#endif
+
+// placement policy for EmbUI's JsonDocuments: 0 - internal RAM, 1 - prefer PSRAM, 2 - per-subsystem bump arena
+#ifndef EMBUI_MEM_POLICY
+#define EMBUI_MEM_POLICY              1
+#endif
+
+// placement policy for Interface frames
+#ifndef EMBUI_MEM_POLICY_INTERFACE
+#define EMBUI_MEM_POLICY_INTERFACE    EMBUI_MEM_POLICY
+#endif
+
+// size of a subsystem's arena for arena policy, bytes
+#ifndef EMBUI_MEM_ARENA_SIZE
+#define EMBUI_MEM_ARENA_SIZE          8192
+#endif
+
 #define EMBUI_WEBSOCK_URI             "/ws"
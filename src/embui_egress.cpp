@@ -0,0 +1,328 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include "embui_egress.hpp"
+#include "ui.h"
+#include "embuifs.hpp"
+#include "embui_defines.h"
+#include "embui_log.h"
+
+// subscription object keys
+static constexpr const char* T_keys = "keys";
+static constexpr const char* T_rate = "rate";
+
+WSEgress::WSEgress(){
+    _tDrain.set(EMBUI_WS_EGRESS_DRAIN_MS * TASK_MILLISECOND, TASK_FOREVER, [this](){ _drain(); });
+}
+
+WSEgress::msg_t WSEgress::_mkmsg(const AsyncWebSocketSharedBuffer& data, JsonVariantConst hdr){
+    msg_t m{data, {}, msg_class_t::frame, 0};
+    if (hdr[P_pkg] == P_interface) m.cls = msg_class_t::interface;
+    if (hdr[P_pkg] != P_value) return m;
+
+    m.cls = msg_class_t::value;
+    // keys signature, sum of key hashes does not depend on keys order
+    for (JsonVariantConst item : hdr[P_block].as<JsonArrayConst>()){
+        if (item[P_html])
+            m.keys += hash_djb2a(item[P_id].as<const char*>() ? item[P_id].as<const char*>() : P_EMPTY);
+        else
+            for (JsonPairConst kv : item.as<JsonObjectConst>())
+                m.keys += hash_djb2a(std::string_view(kv.key().c_str(), kv.key().size()));
+    }
+    return m;
+}
+
+void WSEgress::_mkbuffers(msg_t& m, JsonVariantConst frame, bool json, bool mpack){
+    if (json && !m.data)
+        m.data = frame_serialize(frame);
+
+    if (!mpack || m.mpack) return;
+    JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::egress));
+    if (frame.isNull()){
+        // pre-serialized frame, i.e. from a streaming Interface
+        if (!m.data || deserializeJson(doc, reinterpret_cast<const char*>(m.data->data()), m.data->size())) return;
+        frame = doc;
+    }
+    size_t length = measureMsgPack(frame);
+    m.mpack = std::make_shared< std::vector<uint8_t> >(length);
+    serializeMsgPack(frame, m.mpack->data(), length);
+}
+
+void WSEgress::_transmit(AsyncWebSocketClient *client, const msg_t& m){
+    if (m.mpack && _mpack_clients.count(client->id()))
+        client->binary(m.mpack);
+    else if (m.data)
+        client->text(m.data);
+}
+
+void WSEgress::send(AsyncWebSocket *server, const AsyncWebSocketSharedBuffer& data, JsonVariantConst hdr, JsonVariantConst frame){
+    if (!server->count()) return;
+    msg_t m = _mkmsg(data, hdr);
+    std::lock_guard<std::recursive_mutex> lock(_mtx);
+    // check which formats are required by server's clients
+    bool json{false}, mpack{false};
+    for (auto &c : server->getClients())
+        (_mpack_clients.count(c.id()) ? mpack : json) = true;
+    _mkbuffers(m, frame, json, mpack);
+
+    JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::egress));
+    uint32_t now = millis();
+    for (auto &c : server->getClients()){
+        auto s = m.cls == msg_class_t::value ? _subs.find(c.id()) : _subs.end();
+        if (s == _subs.end() || !(*s).second.active){
+            _enqueue(&c, m);
+            continue;
+        }
+        // filtering needs frame object, pre-serialized frame is parsed once for all subscribers
+        if (frame.isNull() && m.data && !deserializeJson(doc, reinterpret_cast<const char*>(m.data->data()), m.data->size()))
+            frame = doc;
+        if (frame.isNull())
+            _enqueue(&c, m);
+        else
+            _enqueue_filtered(&c, (*s).second, m, frame, now);
+    }
+}
+
+void WSEgress::send(AsyncWebSocketClient *client, const AsyncWebSocketSharedBuffer& data, JsonVariantConst hdr, JsonVariantConst frame){
+    msg_t m = _mkmsg(data, hdr);
+    std::lock_guard<std::recursive_mutex> lock(_mtx);
+    bool mpack = _mpack_clients.count(client->id());
+    _mkbuffers(m, frame, !mpack, mpack);
+    _enqueue(client, m);
+}
+
+void WSEgress::msgpack(uint32_t id, bool enable){
+    std::lock_guard<std::recursive_mutex> lock(_mtx);
+    if (enable)
+        _mpack_clients.insert(id);
+    else
+        _mpack_clients.erase(id);
+}
+
+void WSEgress::subscribe(AsyncWebSocketClient *client, JsonVariantConst sub){
+    std::lock_guard<std::recursive_mutex> lock(_mtx);
+    JsonArrayConst keys = sub[T_keys];
+    if (keys.isNull()){
+        _subs.erase(client->id());
+        return;
+    }
+
+    auto &s = _subs[client->id()];
+    s.server = client->server();
+    JsonObjectConst rate = sub[T_rate];
+    std::unordered_map<unsigned long, sub_key_t> k;
+    for (JsonVariantConst key : keys){
+        const char* id = key.as<const char*>();
+        if (!id) continue;
+        auto h = hash_djb2a(id);
+        auto prev = s.keys.find(h);
+        k[h] = { rate[id].as<uint32_t>(), prev == s.keys.end() ? 0 : (*prev).second.last };
+    }
+    s.keys = std::move(k);
+    s.active = true;
+    LOGD(P_EmbUI, printf, "WS client:%u subscribed to %u keys\n", client->id(), s.keys.size());
+}
+
+void WSEgress::release(uint32_t id){
+    std::lock_guard<std::recursive_mutex> lock(_mtx);
+    _queues.erase(id);
+    _mpack_clients.erase(id);
+    _subs.erase(id);
+}
+
+bool WSEgress::_pass(subscription_t& s, JsonString key, JsonVariantConst value, uint32_t now){
+    auto k = s.keys.find(hash_djb2a(std::string_view(key.c_str(), key.size())));
+    if (k == s.keys.end()){
+        ++_filtered;
+        return false;
+    }
+    if ((*k).second.interval && now - (*k).second.last < (*k).second.interval){
+        // keep the latest value to send it once interval passes
+        // frame might point to caller's memory, key and strings are copied
+        embuifs::deepcopy(s.pending[std::string(key.c_str(), key.size())].to<JsonVariant>(), value);
+        ++_filtered;
+        _arm();
+        return false;
+    }
+    (*k).second.last = now;
+    // a newer value supersedes held back one
+    if (s.pending.size())
+        s.pending.remove(key);
+    return true;
+}
+
+void WSEgress::_enqueue_filtered(AsyncWebSocketClient *client, subscription_t& s, const msg_t& m, JsonVariantConst frame, uint32_t now){
+    JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::egress));
+    doc[P_pkg] = P_value;
+    doc[P_final] = true;
+    JsonArray block = doc[P_block].to<JsonArray>();
+    size_t total{0}, passed{0};
+
+    for (JsonVariantConst item : frame[P_block].as<JsonArrayConst>()){
+        if (item[P_html]){
+            // labeled value object {"id":"someid", "value":"someval", "html": true}
+            ++total;
+            if (item[P_id].is<JsonString>() && _pass(s, item[P_id].as<JsonString>(), item, now)){
+                block.add(item);
+                ++passed;
+            }
+            continue;
+        }
+        JsonObject dict;
+        for (JsonPairConst kv : item.as<JsonObjectConst>()){
+            ++total;
+            if (!_pass(s, kv.key(), kv.value(), now)) continue;
+            if (dict.isNull()) dict = block.add<JsonObject>();
+            dict[kv.key()] = kv.value();
+            ++passed;
+        }
+    }
+
+    if (!passed) return;
+    if (passed == total) return _enqueue(client, m);
+    _enqueue(client, doc);
+}
+
+void WSEgress::_enqueue(AsyncWebSocketClient *client, JsonVariantConst frame){
+    msg_t m = _mkmsg({}, frame);
+    bool mpack = _mpack_clients.count(client->id());
+    _mkbuffers(m, frame, !mpack, mpack);
+    _enqueue(client, m);
+}
+
+bool WSEgress::_flush_pending(uint32_t now){
+    bool left{false};
+    for (auto &i : _subs){
+        auto &s = i.second;
+        if (!s.pending.size()) continue;
+        AsyncWebSocketClient *client = s.server ? s.server->client(i.first) : nullptr;
+        if (!client){
+            s.pending.clear();
+            continue;
+        }
+
+        JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::egress));
+        doc[P_pkg] = P_value;
+        doc[P_final] = true;
+        JsonArray block = doc[P_block].to<JsonArray>();
+        JsonObject dict;
+        // values that are not due yet are moved to a new document, so that memory of sent ones is released
+        JsonDocument rest(embui_mem::allocator(embui_mem::subsys_t::egress));
+
+        for (JsonPairConst kv : s.pending.as<JsonObjectConst>()){
+            auto k = s.keys.find(hash_djb2a(std::string_view(kv.key().c_str(), kv.key().size())));
+            // key is not subscribed anymore
+            if (k == s.keys.end()) continue;
+            if (now - (*k).second.last < (*k).second.interval){
+                embuifs::deepcopy(rest[std::string(kv.key().c_str(), kv.key().size())].to<JsonVariant>(), kv.value());
+                continue;
+            }
+            (*k).second.last = now;
+            if (kv.value()[P_html])
+                block.add(kv.value());
+            else {
+                if (dict.isNull()) dict = block.add<JsonObject>();
+                dict[kv.key()] = kv.value();
+            }
+        }
+
+        s.pending = std::move(rest);
+        if (s.pending.size()) left = true;
+        if (block.size()) _enqueue(client, doc);
+    }
+    return left;
+}
+
+void WSEgress::_enqueue(AsyncWebSocketClient *client, const msg_t& msg){
+    if (client->status() != WS_CONNECTED) return;
+
+    // page is (re)created, client will subscribe to it's keys, until then it gets all values
+    if (msg.cls == msg_class_t::interface){
+        auto s = _subs.find(client->id());
+        if (s != _subs.end()){
+            (*s).second.active = false;
+            (*s).second.pending.clear();
+        }
+    }
+
+    auto i = _queues.find(client->id());
+    // nothing pending and client keeps up - send it right away
+    if (i == _queues.end() && client->queueLen() < EMBUI_WS_CLIENT_INFLIGHT){
+        _transmit(client, msg);
+        return;
+    }
+
+    if (i == _queues.end())
+        i = _queues.emplace(client->id(), client_queue_t{client->server(), {}}).first;
+    auto &q = (*i).second.q;
+
+    // a newer value frame supersedes pending one with same keys
+    if (msg.cls == msg_class_t::value && msg.keys){
+        for (auto m = q.begin(); m != q.end(); ++m){
+            if ((*m).cls == msg_class_t::value && (*m).keys == msg.keys){
+                q.erase(m);
+                break;
+            }
+        }
+    }
+    q.push_back(msg);
+
+    // queue overflow - evict oldest value frame
+    if (q.size() > EMBUI_WS_CLIENT_QUEUE){
+        for (auto m = q.begin(); m != q.end(); ++m){
+            if ((*m).cls == msg_class_t::value){
+                q.erase(m);
+                ++_evictions;
+                break;
+            }
+        }
+    }
+
+    // still overflowed with frames that can't be dropped, client can't keep up
+    if (q.size() > EMBUI_WS_CLIENT_QUEUE){
+        LOGW(P_EmbUI, printf, "WS client:%u can't keep up, disconnecting\n", client->id());
+        ++_disconnects;
+        _queues.erase(i);
+        client->close();
+        return;
+    }
+
+    _arm();
+}
+
+void WSEgress::begin(){
+    if (_task_added) return;
+    ts.addTask(_tDrain);
+    _task_added = true;
+    _tDrain.enable();
+}
+
+void WSEgress::_drain(){
+    if (!_armed.load()) return;
+    std::lock_guard<std::recursive_mutex> lock(_mtx);
+    for (auto i = _queues.begin(); i != _queues.end(); ){
+        AsyncWebSocketClient *client = (*i).second.server->client((*i).first);
+        auto &q = (*i).second.q;
+        if (!client || client->status() != WS_CONNECTED){
+            i = _queues.erase(i);
+            continue;
+        }
+        while (q.size() && client->queueLen() < EMBUI_WS_CLIENT_INFLIGHT){
+            _transmit(client, q.front());
+            q.pop_front();
+        }
+        if (q.empty())
+            i = _queues.erase(i);
+        else
+            ++i;
+    }
+    // producers arm it under the same lock, so no signal is lost here
+    _armed.store(_flush_pending(millis()) || !_queues.empty());
+}
@@ -0,0 +1,229 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include "ESPAsyncWebServer.h"
+#include "ArduinoJson.h"
+#include "embui_mem.hpp"
+#include "ts.h"
+
+/**
+ * @brief per-client WebSocket egress queues
+ * frames are handed over to AsyncWebSocket client only while it's own queue is short,
+ * the rest are kept here per client. Pending value frames are coalesced, i.e. a newer value frame
+ * replaces a queued one with the same set of keys. Interface frames are always kept in order.
+ * When pending queue exceeds it's depth, value frames are evicted first, if client still can't keep up
+ * it is disconnected, so that a slow client never holds memory for the others.
+ * Clients that negotiated MessagePack protocol receive frames as binary MessagePack messages,
+ * the rest get json text.
+ * Clients could subscribe to a set of value keys, i.e. the ones displayed on the current page, optionally
+ * with a min interval between deliveries per key. Such clients get value frames broadcasted to all clients
+ * filtered to subscribed keys, rate-limited values are held back and the latest one is delivered once interval passes.
+ * Clients without a subscription get all values. Filtering is suspended when a client is sent an interface frame,
+ * until it subscribes to the keys of a new page
+ */
+class WSEgress {
+    // frame class
+    enum class msg_class_t : uint8_t {
+        frame = 0,      // non-value frames, must be delivered in order
+        interface,      // interface frame, same as frame, but it (re)creates page elements
+        value           // value frame, could be replaced with a newer one with same keys
+    };
+
+    struct msg_t {
+        // json text
+        AsyncWebSocketSharedBuffer data;
+        // MessagePack, made only if there are clients that accept it
+        AsyncWebSocketSharedBuffer mpack;
+        msg_class_t cls;
+        // value frame's keys signature, 0 - unknown
+        uint32_t keys;
+    };
+
+    struct client_queue_t {
+        AsyncWebSocket *server;
+        std::deque<msg_t> q;
+    };
+
+    // subscribed value key
+    struct sub_key_t {
+        // min interval between deliveries, ms, 0 - no limit
+        uint32_t interval;
+        // last delivery time, ms
+        uint32_t last;
+    };
+
+    // client's value subscription
+    struct subscription_t {
+        AsyncWebSocket *server{nullptr};
+        // subscribed keys, mapped by key hash
+        std::unordered_map<unsigned long, sub_key_t> keys;
+        // values held back by rate limit, the latest one per key
+        JsonDocument pending{embui_mem::allocator(embui_mem::subsys_t::egress)};
+        // filtering is suspended after an interface frame is sent to a client
+        bool active{true};
+    };
+
+    // pending frames, mapped by client id
+    std::map<uint32_t, client_queue_t> _queues;
+    // value subscriptions, mapped by client id
+    std::map<uint32_t, subscription_t> _subs;
+    // ids of clients that accept MessagePack
+    std::set<uint32_t> _mpack_clients;
+    std::recursive_mutex _mtx;
+    Task _tDrain;
+    bool _task_added{false};
+    // there are pending frames or values, set from any task, polled by drain task
+    std::atomic<bool> _armed{false};
+    uint32_t _evictions{0};
+    uint32_t _disconnects{0};
+    uint32_t _filtered{0};
+
+    WSEgress();
+
+    // make frame's queue entry
+    static msg_t _mkmsg(const AsyncWebSocketSharedBuffer& data, JsonVariantConst hdr);
+
+    /**
+     * @brief make message buffers for the formats required
+     * 
+     * @param m message
+     * @param frame frame object, if null then MessagePack is made from json buffer
+     * @param json make json buffer
+     * @param mpack make MessagePack buffer
+     */
+    static void _mkbuffers(msg_t& m, JsonVariantConst frame, bool json, bool mpack);
+
+    // send message to client in it's format
+    void _transmit(AsyncWebSocketClient *client, const msg_t& m);
+
+    // send/enqueue message to a client, must be called under lock
+    void _enqueue(AsyncWebSocketClient *client, const msg_t& msg);
+
+    // make message from a frame object and enqueue it in client's format, must be called under lock
+    void _enqueue(AsyncWebSocketClient *client, JsonVariantConst frame);
+
+    /**
+     * @brief enqueue value frame filtered with client's subscription, must be called under lock
+     * 
+     * @param client
+     * @param s client's subscription
+     * @param m original message, sent as-is if all of it's values pass the filter
+     * @param frame frame object
+     * @param now current time, ms
+     */
+    void _enqueue_filtered(AsyncWebSocketClient *client, subscription_t& s, const msg_t& m, JsonVariantConst frame, uint32_t now);
+
+    /**
+     * @brief check if subscriber should get a value now
+     * rate-limited value is placed to subscription's pending values
+     * 
+     * @param s subscription
+     * @param key value's key
+     * @param value value or labeled value object
+     * @param now current time, ms
+     * @return true if value should be sent
+     */
+    bool _pass(subscription_t& s, JsonString key, JsonVariantConst value, uint32_t now);
+
+    /**
+     * @brief send pending rate-limited values that are due, must be called under lock
+     * @return true if there are values still pending
+     */
+    bool _flush_pending(uint32_t now);
+
+    // signal drain task that there is pending work, could be called from any task
+    void _arm(){ _armed.store(true); }
+
+    // send pending frames to clients that are ready to accept it
+    void _drain();
+
+public:
+    // this is a singleton
+    WSEgress(WSEgress const&) = delete;
+    void operator=(WSEgress const&) = delete;
+
+    /**
+     * obtain a reference to singleton instance
+     */
+    static WSEgress& getInstance(){
+        static WSEgress inst;
+        return inst;
+    }
+
+    /**
+     * @brief start drain task, must be called from EmbUI's task
+     * frames could be sent from any task, i.e. AsyncTCP's one, while TaskScheduler is not thread-safe,
+     * so the task is added once and just polls for pending work
+     */
+    void begin();
+
+    /**
+     * @brief send frame to all clients of a WebSocket server
+     *
+     * @param server
+     * @param data serialized json frame, could be null if frame object is given
+     * @param hdr frame object or it's header, used to classify the frame
+     * @param frame frame object, if given it is serialized on demand to the formats required by clients
+     */
+    void send(AsyncWebSocket *server, const AsyncWebSocketSharedBuffer& data, JsonVariantConst hdr, JsonVariantConst frame = {});
+
+    /**
+     * @brief send frame to a single client
+     *
+     * @param client
+     * @param data serialized json frame, could be null if frame object is given
+     * @param hdr frame object or it's header, used to classify the frame
+     * @param frame frame object, if given it is serialized on demand to the format required by client
+     */
+    void send(AsyncWebSocketClient *client, const AsyncWebSocketSharedBuffer& data, JsonVariantConst hdr, JsonVariantConst frame = {});
+
+    /**
+     * @brief set client's protocol format
+     * 
+     * @param id client id
+     * @param enable send MessagePack binary messages to client instead of json text
+     */
+    void msgpack(uint32_t id, bool enable);
+
+    /**
+     * @brief set client's value subscription
+     * subscription object {"keys":["key1", "key2"], "rate":{"key1":1000}}, where 'rate' is an optional min interval between
+     * deliveries of a value in ms. Object without 'keys' removes subscription, i.e. client gets all values
+     * 
+     * @param client
+     * @param sub subscription object
+     */
+    void subscribe(AsyncWebSocketClient *client, JsonVariantConst sub);
+
+    /**
+     * @brief drop client's pending queue and settings
+     * should be called on client disconnect
+     *
+     * @param id client id
+     */
+    void release(uint32_t id);
+
+    // number of value frames evicted due to queue overflow
+    uint32_t evictions() const { return _evictions; }
+
+    // number of clients disconnected due to queue overflow
+    uint32_t disconnects() const { return _disconnects; }
+
+    // number of values not sent to clients due to subscriptions
+    uint32_t filtered() const { return _filtered; }
+};
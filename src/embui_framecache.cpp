@@ -0,0 +1,156 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include "embui_framecache.hpp"
+#include "EmbUI.h"
+#include "embui_log.h"
+
+// action data that serializes to this size or larger is not used for cache keys
+static constexpr size_t key_data_max = 64;
+
+// continue djb2a hash over a string
+static inline action_id_t key_mix(action_id_t h, std::string_view s){
+    for (unsigned char c : s)
+        h = ((h << 5) + h) ^ c;
+    return h;
+}
+
+void FrameCache::FrameSendCapture::_capture(const AsyncWebSocketSharedBuffer& data, const JsonVariantConst& hdr){
+    const char* pkg = hdr[P_pkg];
+    if (!data || !pkg){
+        uncacheable = true;
+        return;
+    }
+    frames.emplace_back(frame_t{data, pkg});
+    bytes += data->size();
+}
+
+void FrameCache::FrameSendCapture::send(const char* data){
+    // not a frame, can't be replayed
+    uncacheable = true;
+    if (_target) _target->send(data);
+}
+
+void FrameCache::FrameSendCapture::send(const JsonVariantConst& data){
+    auto buff = frame_serialize(data);
+    _capture(buff, data);
+    if (!_target) return;
+    if (_target->accepts_raw(data))
+        _target->send(buff, data);
+    else
+        _target->send(data);
+}
+
+void FrameCache::FrameSendCapture::send(const AsyncWebSocketSharedBuffer& data){
+    // frame type is unknown
+    uncacheable = true;
+    if (_target) _target->send(data);
+}
+
+void FrameCache::FrameSendCapture::send(const AsyncWebSocketSharedBuffer& data, const JsonVariantConst& hdr){
+    _capture(data, hdr);
+    if (_target) _target->send(data, hdr);
+}
+
+FrameCache::Capture::Capture(Interface *interf, action_id_t key) :
+    _interf(interf), _key(key), _gen(FrameCache::getInstance().generation()), _cap(interf->feeder()), _prev(interf->feeder(&_cap)) {}
+
+FrameCache::Capture::~Capture(){
+    // flushes any opened frame to capture
+    _interf->feeder(_prev);
+    FrameCache::getInstance()._store(_key, _gen, _cap);
+}
+
+action_id_t FrameCache::key(const char* action, JsonVariantConst data){
+    if (!action) return 0;
+    char buff[key_data_max];
+    size_t len{0};
+    if (!data.isNull()){
+        if (measureJson(data) >= key_data_max) return 0;
+        len = serializeJson(data, buff, key_data_max);
+    }
+
+    action_id_t h = hash_djb2a(action);
+    h = key_mix(h, std::string_view("", 1));
+    h = key_mix(h, std::string_view(buff, len));
+    h = key_mix(h, std::string_view("", 1));
+    h = key_mix(h, embui.getLang());
+    // 0 is reserved for 'do not cache'
+    return h ? h : 1;
+}
+
+void FrameCache::cacheable(const char* action, bool enable){
+    if (!action) return;
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (enable)
+        _optin.insert(hash_djb2a(action));
+    else
+        _optin.erase(hash_djb2a(action));
+    // drop pages built before
+    _cache.clear();
+    _bytes = 0;
+}
+
+bool FrameCache::cacheable(const char* action){
+    if (!action) return false;
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _optin.count(hash_djb2a(action));
+}
+
+void FrameCache::_store(action_id_t key, uint32_t gen, FrameSendCapture& cap){
+    if (cap.uncacheable || cap.frames.empty() || cap.bytes > EMBUI_FRAMECACHE_SIZE) return;
+
+    std::lock_guard<std::mutex> lock(_mtx);
+    // config has changed while page was built, frames might be inconsistent
+    if (gen != _gen) return;
+
+    auto i = _cache.find(key);
+    if (i != _cache.end()){
+        _bytes -= (*i).second.bytes;
+        _cache.erase(i);
+    }
+    // make room for the new entry
+    while (_cache.size() && _bytes + cap.bytes > EMBUI_FRAMECACHE_SIZE){
+        _bytes -= _cache.begin()->second.bytes;
+        _cache.erase(_cache.begin());
+    }
+
+    _bytes += cap.bytes;
+    _cache.emplace(key, entry_t{gen, cap.bytes, std::move(cap.frames)});
+    LOGD(P_EmbUI, printf, "FrameCache store key:%lx, %u bytes, total %u\n", key, cap.bytes, _bytes);
+}
+
+bool FrameCache::replay(Interface *interf, action_id_t key){
+    if (!interf || !key) return false;
+
+    std::vector<frame_t> frames;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        auto i = _cache.find(key);
+        if (i == _cache.end() || (*i).second.gen != _gen){
+            ++_misses;
+            return false;
+        }
+        // buffers are shared, frames are sent without holding the lock
+        frames = (*i).second.frames;
+        ++_hits;
+    }
+
+    for (const auto &f : frames)
+        interf->json_frame_static(f.data, f.pkg.c_str());
+    return true;
+}
+
+void FrameCache::invalidate(){
+    ++_gen;
+    std::lock_guard<std::mutex> lock(_mtx);
+    _cache.clear();
+    _bytes = 0;
+}
@@ -0,0 +1,182 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "ui.h"
+#include "embui_action.hpp"
+#include "embui_defines.h"
+
+/**
+ * @brief cache of serialized page frames
+ * page builders are executed once, frames they produce are captured and replayed to the next requesters as-is.
+ * Cache is keyed with action, it's data and UI language. Cached frames are valid until configuration generation changes,
+ * it is incremented on any system or unit config change.
+ * Only pages that are built from configuration could be cached, pages that show live device state,
+ * i.e. current time, WiFi status, etc... must not be cached, such data should be sent with value frames outside of cached builders.
+ * Pages that run user's actions (main page, user's blocks of the settings page) are cached only if those actions are
+ * opted in with cacheable()
+ *
+ * Example:
+ *  auto key = FrameCache::key(A_my_page, data);
+ *  FrameCache::getInstance().build(interf, key, [interf](){ my_page(interf); });
+ */
+class FrameCache {
+    // cached frame
+    struct frame_t {
+        AsyncWebSocketSharedBuffer data;
+        // frame's 'pkg' type
+        std::string pkg;
+    };
+
+    struct entry_t {
+        // config generation entry was captured with
+        uint32_t gen;
+        size_t bytes;
+        std::vector<frame_t> frames;
+    };
+
+    /**
+     * @brief a sender that captures frames and passes them to the wrapped sender
+     */
+    class FrameSendCapture : public FrameSend {
+        FrameSend *_target;
+
+        void _capture(const AsyncWebSocketSharedBuffer& data, const JsonVariantConst& hdr);
+
+    public:
+        std::vector<frame_t> frames;
+        size_t bytes{0};
+        // a frame that can't be replayed was sent
+        bool uncacheable{false};
+
+        explicit FrameSendCapture(FrameSend *target) : _target(target) {}
+
+        bool available() const override { return _target && _target->available(); }
+        void send(const char* data) override;
+        void send(const JsonVariantConst& data) override;
+        void send(const AsyncWebSocketSharedBuffer& data) override;
+        void send(const AsyncWebSocketSharedBuffer& data, const JsonVariantConst& hdr) override;
+        bool accepts_raw(const JsonVariantConst& data) const override { return true; }
+    };
+
+    std::unordered_map<action_id_t, entry_t> _cache;
+    // user's actions opted in for caching, mapped by action's hash
+    std::unordered_set<action_id_t> _optin;
+    // config generation
+    std::atomic<uint32_t> _gen{1};
+    // bytes held by cached frames
+    size_t _bytes{0};
+    uint32_t _hits{0};
+    uint32_t _misses{0};
+    std::mutex _mtx;
+
+    FrameCache() = default;
+
+    // store captured frames
+    void _store(action_id_t key, uint32_t gen, FrameSendCapture& cap);
+
+public:
+    // this is a singleton
+    FrameCache(FrameCache const&) = delete;
+    void operator=(FrameCache const&) = delete;
+
+    /**
+     * obtain a reference to singleton instance
+     */
+    static FrameCache& getInstance(){
+        static FrameCache inst;
+        return inst;
+    }
+
+    /**
+     * @brief captures frames sent by Interface object within it's lifetime and stores it in cache on destruction
+     * frames are still delivered to Interface's sender. Frames are not stored if config generation has changed
+     * while frames were captured
+     */
+    class Capture {
+        Interface *_interf;
+        action_id_t _key;
+        uint32_t _gen;
+        FrameSendCapture _cap;
+        FrameSend *_prev;
+
+    public:
+        Capture(Interface *interf, action_id_t key);
+        ~Capture();
+        Capture(const Capture&) = delete;
+        Capture& operator=(const Capture&) = delete;
+    };
+
+    /**
+     * @brief make cache key for action
+     *
+     * @param action action name
+     * @param data action's data, only small scalar or object data could be used for a key
+     * @return action_id_t key, 0 if data is too large to make a key, such requests are not cached
+     */
+    static action_id_t key(const char* action, JsonVariantConst data = {});
+
+    /**
+     * @brief send cached frames for the key
+     *
+     * @return true on cache hit
+     * @return false if frames for the key are not cached or stale
+     */
+    bool replay(Interface *interf, action_id_t key);
+
+    /**
+     * @brief send cached frames or execute page builder capturing it's frames
+     *
+     * @param interf
+     * @param key cache key, 0 - execute builder without caching
+     * @param builder function that builds page using interf
+     */
+    template <typename F>
+    void build(Interface *interf, action_id_t key, F&& builder){
+        if (!interf) return;
+        if (!key || !EMBUI_FRAMECACHE_SIZE) return builder();
+        if (replay(interf, key)) return;
+        Capture cap(interf, key);
+        builder();
+    }
+
+    /**
+     * @brief allow caching of pages built by user's action
+     * action's output must depend on configuration only
+     *
+     * @param action action name, i.e. A_ui_page_main
+     * @param enable
+     */
+    void cacheable(const char* action, bool enable = true);
+
+    // check if pages built by user's action could be cached
+    bool cacheable(const char* action);
+
+    // current config generation
+    uint32_t generation() const { return _gen; }
+
+    /**
+     * @brief increment config generation and drop cached frames
+     * should be called on any config change that might affect pages
+     */
+    void invalidate();
+
+    // bytes held by cached frames
+    size_t size() const { return _bytes; }
+    uint32_t hits() const { return _hits; }
+    uint32_t misses() const { return _misses; }
+};
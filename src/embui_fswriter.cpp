@@ -0,0 +1,150 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include <algorithm>
+#include <LittleFS.h>
+#include "embui_fswriter.hpp"
+#include "esp_timer.h"
+#include "embui_log.h"
+
+static constexpr const char* T_tmp_suffix = ".tmp";
+
+FSWriter::FSWriter(){
+    _tDone.set(EMBUI_FSWRITER_POLL_MS * TASK_MILLISECOND, TASK_FOREVER, [this](){ _process(); });
+}
+
+bool FSWriter::begin(uint32_t stack, BaseType_t core, UBaseType_t priority){
+    if (_task) return true;
+    if (xTaskCreatePinnedToCore(_writer, "embui_fsw", stack, this, priority, &_task, core) != pdPASS){
+        LOGE(P_EmbUI, println, "can't start FS writer task");
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void FSWriter::_writer(void* arg){
+    auto w = static_cast<FSWriter*>(arg);
+    for (;;){
+        job_t job;
+        {
+            std::unique_lock<std::mutex> lock(w->_mtx);
+            w->_cv.wait(lock, [w](){ return !w->_queue.empty(); });
+            job = std::move(w->_queue.front());
+            w->_queue.pop_front();
+            w->_active = job.path;
+        }
+
+        int64_t t = esp_timer_get_time();
+        job.result = w->_write(job);
+        uint32_t us = esp_timer_get_time() - t;
+        // content is not needed anymore, release it before the job waits for callbacks
+        std::vector<uint8_t>().swap(job.data);
+
+        {
+            std::lock_guard<std::mutex> lock(w->_mtx);
+            w->_active.clear();
+            if (job.result){
+                ++w->_stat.writes;
+                w->_stat.bytes += job.result;
+            } else
+                ++w->_stat.failed;
+            w->_stat.last_us = us;
+            w->_stat.max_us = std::max(w->_stat.max_us, us);
+            w->_done.emplace_back(std::move(job));
+        }
+        w->_cv.notify_all();
+    }
+}
+
+size_t FSWriter::_write(const job_t& job){
+    String tmp(job.path.c_str());
+    tmp += T_tmp_suffix;
+    File f = LittleFS.open(tmp, "w");
+    if (!f){
+        LOGE(P_EmbUI, printf, "can't open file: %s\n", tmp.c_str());
+        return 0;
+    }
+    size_t written = f.write(job.data.data(), job.data.size());
+    f.close();
+
+    // incomplete write, i.e. FS is full. Destination file is left untouched
+    if (written != job.data.size() || !LittleFS.rename(tmp, job.path.c_str())){
+        LOGE(P_EmbUI, printf, "failed to write file: %s\n", job.path.c_str());
+        LittleFS.remove(tmp);
+        return 0;
+    }
+    return written;
+}
+
+bool FSWriter::write(const char* path, std::vector<uint8_t>&& data, fs_write_cb_t cb){
+    if (!path || !begin()) return false;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        auto i = std::find_if(_queue.begin(), _queue.end(), [path](const job_t& j){ return j.path == path; });
+        if (i != _queue.end()){
+            // write was not started yet, replace it's content with newer one
+            i->data = std::move(data);
+            if (cb) i->cbs.emplace_back(std::move(cb));
+            ++_stat.coalesced;
+        } else {
+            if (_queue.size() >= EMBUI_FSWRITER_QUEUE) return false;
+            job_t job{path, std::move(data), {}, 0};
+            if (cb) job.cbs.emplace_back(std::move(cb));
+            _queue.emplace_back(std::move(job));
+        }
+    }
+    _cv.notify_all();
+
+    if (!_task_added){
+        ts.addTask(_tDone);
+        _task_added = true;
+    }
+    _tDone.enableIfNot();
+    return true;
+}
+
+void FSWriter::sync(const char* path){
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        if (path){
+            std::string p(path);
+            _cv.wait(lock, [this, &p](){
+                return _active != p && std::none_of(_queue.cbegin(), _queue.cend(), [&p](const job_t& j){ return j.path == p; });
+            });
+        } else
+            _cv.wait(lock, [this](){ return _queue.empty() && _active.empty(); });
+    }
+    // sync is called from EmbUI's task, completions could be delivered right away
+    _process();
+}
+
+void FSWriter::_process(){
+    std::list<job_t> done;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        done.swap(_done);
+    }
+    for (auto &j : done)
+        for (auto &cb : j.cbs)
+            cb(j.result);
+
+    // callbacks might have queued new writes
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (_queue.empty() && _active.empty() && _done.empty())
+        _tDone.disable();
+}
+
+FSWriter::stat_t FSWriter::stats() const {
+    std::lock_guard<std::mutex> lock(_mtx);
+    stat_t s = _stat;
+    s.queued = _queue.size();
+    return s;
+}
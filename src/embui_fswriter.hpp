@@ -0,0 +1,128 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "embui_defines.h"
+#include "ts.h"
+
+/**
+ * @brief write completion callback, executed on EmbUI's task
+ * @param written bytes written, 0 if write has failed
+ */
+using fs_write_cb_t = std::function< void (size_t written)>;
+
+/**
+ * @brief background file writer
+ * LittleFS write with flash erase could take tens of milliseconds, when executed on EmbUI's task it stalls the scheduler.
+ * Callers serialize data to RAM and hand the buffer over to the writer task, files are written atomically
+ * via a temp file and rename, same as embuifs::serialize2fileAtomic() does. A pending write of the same file is
+ * replaced with newer content, so at most one buffer per file is being written and one is waiting.
+ * Completion callbacks are executed on EmbUI's task. Readers must call sync() for the file before reading it,
+ * embuifs::deserializeFileAtomic() does it.
+ */
+class FSWriter {
+public:
+    struct stat_t {
+        // files waiting to be written
+        size_t queued;
+        uint32_t writes;
+        uint32_t bytes;
+        // writes replaced with newer content before they were started
+        uint32_t coalesced;
+        uint32_t failed;
+        // write duration, us
+        uint32_t last_us;
+        uint32_t max_us;
+    };
+
+private:
+    struct job_t {
+        std::string path;
+        std::vector<uint8_t> data;
+        std::vector<fs_write_cb_t> cbs;
+        size_t result;
+    };
+
+    mutable std::mutex _mtx;
+    std::condition_variable _cv;
+    // files waiting to be written
+    std::list<job_t> _queue;
+    // written files with completion callbacks pending
+    std::list<job_t> _done;
+    // file being written
+    std::string _active;
+    TaskHandle_t _task{nullptr};
+    Task _tDone;
+    bool _task_added{false};
+    stat_t _stat{};
+
+    FSWriter();
+
+    // writer task
+    static void _writer(void* arg);
+
+    // write file atomically
+    size_t _write(const job_t& job);
+
+    // execute completion callbacks, runs on EmbUI's task
+    void _process();
+
+public:
+    // this is a singleton
+    FSWriter(FSWriter const&) = delete;
+    void operator=(FSWriter const&) = delete;
+
+    /**
+     * obtain a reference to singleton instance
+     */
+    static FSWriter& getInstance(){
+        static FSWriter inst;
+        return inst;
+    }
+
+    /**
+     * @brief start writer task
+     * writer is started with default settings on first write if begin() was not called
+     *
+     * @param stack task's stack size, bytes
+     * @param core core to pin writer task to, tskNO_AFFINITY - any core
+     * @param priority task's priority
+     * @return true on success
+     */
+    bool begin(uint32_t stack = EMBUI_FSWRITER_STACK, BaseType_t core = EMBUI_FSWRITER_CORE, UBaseType_t priority = EMBUI_FSWRITER_PRIORITY);
+
+    /**
+     * @brief hand over file's content for background write, should be called from EmbUI's task
+     *
+     * @param path destination file
+     * @param data file's content, buffer is moved to the writer
+     * @param cb completion callback
+     * @return false if writer is not available or queue is full, data is left intact then
+     */
+    bool write(const char* path, std::vector<uint8_t>&& data, fs_write_cb_t cb = nullptr);
+
+    /**
+     * @brief wait until pending write of the file is complete
+     *
+     * @param path file name, nullptr - wait for all pending writes
+     */
+    void sync(const char* path = nullptr);
+
+    stat_t stats() const;
+};
@@ -0,0 +1,49 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include "embui_generator.hpp"
+#include "embui_log.h"
+
+FrameGenerator::FrameGenerator(){
+    // runs on each scheduler pass while there are generators in progress
+    _tGen.set(TASK_IMMEDIATE, TASK_FOREVER, [this](){ _run(); });
+}
+
+void FrameGenerator::run(FrameSend *feeder, embui_gen_step_t step){
+    if (!feeder || !step) return;
+    _gens.emplace_back(gen_t{ std::make_unique<Interface>(feeder), std::move(step), 0 });
+    if (!_task_added){
+        ts.addTask(_tGen);
+        _task_added = true;
+    }
+    _tGen.enableIfNot();
+}
+
+void FrameGenerator::_run(){
+    for (auto i = _gens.begin(); i != _gens.end(); ){
+        auto &g = *i;
+        if (!g.interf->feeder()->available()){
+            LOGD(P_EmbUI, printf, "generator dropped after %u steps, feeder unavailable\n", g.n);
+            i = _gens.erase(i);
+            continue;
+        }
+        bool more = g.step(g.interf.get(), g.n++);
+        ++_steps;
+        if (more){
+            // send the chunk, sections stay opened for the next step
+            if (g.interf->json_frame_open()) g.interf->json_frame_send();
+            ++i;
+        } else {
+            g.interf->json_frame_flush();
+            i = _gens.erase(i);
+        }
+    }
+    if (_gens.empty()) _tGen.disable();
+}
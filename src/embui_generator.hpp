@@ -0,0 +1,87 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <memory>
+#include "ui.h"
+#include "ts.h"
+
+/**
+ * @brief generator step, called on consecutive scheduler ticks until it returns false
+ *
+ * @param interf Interface to add UI objects to, it keeps opened frame and sections between steps
+ * @param step step number, starting from 0
+ * @return true if there is more data to generate
+ */
+using embui_gen_step_t = std::function< bool (Interface *interf, size_t step)>;
+
+/**
+ * @brief incremental page generator
+ * large pages, i.e. long lists of units or files, take many milliseconds to build and stall the scheduler
+ * with all UI traffic. A page could be built with a step function instead, one step is executed per scheduler tick,
+ * data added within a step is sent as a continuation chunk with json_frame_send() and the frame is flushed
+ * after the last step. Sections opened in one step remain opened for the next one, so WebUI gets the same page
+ * as if it was built in one call.
+ *
+ * Example:
+ *  FrameGenerator::getInstance().run(&embui.feeders, [items](Interface *interf, size_t step){
+ *      if (!step) interf->json_frame_value();
+ *      for (size_t i = step * 10; i != std::min(items.size(), step * 10 + 10); ++i) interf->value(items[i].id, items[i].val);
+ *      return (step + 1) * 10 < items.size();
+ *  });
+ */
+class FrameGenerator {
+    struct gen_t {
+        std::unique_ptr<Interface> interf;
+        embui_gen_step_t step;
+        size_t n;
+    };
+
+    std::list<gen_t> _gens;
+    Task _tGen;
+    bool _task_added{false};
+    uint32_t _steps{0};
+
+    FrameGenerator();
+
+    // execute one step of each active generator
+    void _run();
+
+public:
+    // this is a singleton
+    FrameGenerator(FrameGenerator const&) = delete;
+    void operator=(FrameGenerator const&) = delete;
+
+    /**
+     * obtain a reference to singleton instance
+     */
+    static FrameGenerator& getInstance(){
+        static FrameGenerator inst;
+        return inst;
+    }
+
+    /**
+     * @brief start incremental page generation
+     * generator is dropped if feeder becomes unavailable
+     *
+     * @param feeder sender to publish frames to, it must outlive the generator, i.e. &embui.feeders
+     * @param step step function
+     */
+    void run(FrameSend *feeder, embui_gen_step_t step);
+
+    // number of generators in progress
+    size_t active() const { return _gens.size(); }
+
+    // total number of steps executed
+    uint32_t steps() const { return _steps; }
+};
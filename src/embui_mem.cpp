@@ -0,0 +1,222 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include <cstring>
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "embui_mem.hpp"
+#include "embui_defines.h"
+
+namespace embui_mem {
+
+// arena block header, keeps block's payload size, 8 bytes to keep payload aligned
+static constexpr size_t arena_hdr = 8;
+
+static inline size_t arena_blocklen(size_t size){ return arena_hdr + ((size + 7) & ~static_cast<size_t>(7)); }
+
+size_t Arena::blocksize(const void* ptr){ return *reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(ptr) - arena_hdr); }
+
+void* Arena::allocate(size_t size){
+    size_t len = arena_blocklen(size);
+    if (!_base || _offset + len > _size) return nullptr;
+
+    uint8_t *block = _base + _offset;
+    *reinterpret_cast<uint32_t*>(block) = size;
+    _last = _offset;
+    _offset += len;
+    ++_live;
+    return block + arena_hdr;
+}
+
+void Arena::deallocate(void*){
+    // space is not reused until all blocks are released
+    if (_live && --_live == 0)
+        _offset = _last = 0;
+}
+
+void* Arena::reallocate(void* ptr, size_t new_size){
+    uint8_t *block = static_cast<uint8_t*>(ptr) - arena_hdr;
+    size_t len = arena_blocklen(new_size);
+    if (block == _base + _last && _last + len <= _size){
+        *reinterpret_cast<uint32_t*>(block) = new_size;
+        _offset = _last + len;
+        return ptr;
+    }
+
+    void* p = allocate(new_size);
+    if (!p) return nullptr;
+    size_t old_size = blocksize(ptr);
+    std::memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    deallocate(ptr);
+    return p;
+}
+
+void* Allocator::_heap_alloc(size_t size, policy_t p){
+    if (p == policy_t::internal)
+        return heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return heap_caps_malloc_prefer(size, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_DEFAULT);
+}
+
+void Allocator::_account(size_t add, size_t sub){
+    size_t u = (_used += add - sub);
+    // counters are informational, a racy peak update is acceptable
+    if (add > sub && u > _peak) _peak = u;
+}
+
+void* Allocator::allocate(size_t size){
+    ++_allocs;
+    void* ptr{nullptr};
+    if (_policy == policy_t::arena){
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (!_arena.valid()){
+            void* buff = _heap_alloc(EMBUI_MEM_ARENA_SIZE, policy_t::psram);
+            if (buff){
+                _arena.assign(buff, EMBUI_MEM_ARENA_SIZE);
+                // arena's memory is accounted for as a whole
+                _account(EMBUI_MEM_ARENA_SIZE, 0);
+            }
+        }
+        ptr = _arena.allocate(size);
+    }
+    if (!ptr){
+        ptr = _heap_alloc(size, _policy == policy_t::internal ? policy_t::internal : policy_t::psram);
+        if (ptr) _account(heap_caps_get_allocated_size(ptr), 0);
+    }
+    if (!ptr) ++_fails;
+    return ptr;
+}
+
+void Allocator::deallocate(void* ptr){
+    if (!ptr) return;
+    if (_arena.owns(ptr)){
+        std::lock_guard<std::mutex> lock(_mtx);
+        _arena.deallocate(ptr);
+        return;
+    }
+    _account(0, heap_caps_get_allocated_size(ptr));
+    heap_caps_free(ptr);
+}
+
+void* Allocator::reallocate(void* ptr, size_t new_size){
+    if (!ptr) return allocate(new_size);
+
+    if (_arena.owns(ptr)){
+        std::unique_lock<std::mutex> lock(_mtx);
+        void* p = _arena.reallocate(ptr, new_size);
+        if (p) return p;
+        lock.unlock();
+
+        // arena is exhausted, move block to heap
+        p = _heap_alloc(new_size, policy_t::psram);
+        if (!p){
+            ++_fails;
+            return nullptr;
+        }
+        _account(heap_caps_get_allocated_size(p), 0);
+        size_t old_size = Arena::blocksize(ptr);
+        std::memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+        deallocate(ptr);
+        return p;
+    }
+
+    // heap block stays in it's region, realloc won't move internal RAM block to PSRAM or vice versa
+    size_t old_size = heap_caps_get_allocated_size(ptr);
+    void* p = heap_caps_realloc(ptr, new_size, esp_ptr_external_ram(ptr) ? MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT : MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!p){
+        ++_fails;
+        return nullptr;
+    }
+    _account(heap_caps_get_allocated_size(p), old_size);
+    return p;
+}
+
+void* Allocator::allocate_block(size_t size){
+    ++_allocs;
+    void* ptr = _heap_alloc(size, _policy == policy_t::internal ? policy_t::internal : policy_t::psram);
+    if (ptr)
+        _account(heap_caps_get_allocated_size(ptr), 0);
+    else
+        ++_fails;
+    return ptr;
+}
+
+void* BufferAllocator::allocate(size_t size){
+    ++_allocs;
+    void* ptr = _arena.allocate(size);
+    if (!ptr) ++_fails;
+    if (_arena.used() > _peak) _peak = _arena.used();
+    return ptr;
+}
+
+void* BufferAllocator::reallocate(void* ptr, size_t new_size){
+    if (!ptr) return allocate(new_size);
+    void* p = _arena.reallocate(ptr, new_size);
+    if (!p) ++_fails;
+    if (_arena.used() > _peak) _peak = _arena.used();
+    return p;
+}
+
+void* SlotAllocator::allocate(size_t size){
+    if (!_block){
+        _block = _parent->allocate_block(_size);
+        if (_block) _arena.assign(_block, _size);
+    }
+    void* ptr = _arena.allocate(size);
+    return ptr ? ptr : _parent->allocate(size);
+}
+
+void SlotAllocator::deallocate(void* ptr){
+    if (_arena.owns(ptr))
+        _arena.deallocate(ptr);
+    else
+        _parent->deallocate(ptr);
+}
+
+void* SlotAllocator::reallocate(void* ptr, size_t new_size){
+    if (!ptr) return allocate(new_size);
+    if (!_arena.owns(ptr)) return _parent->reallocate(ptr, new_size);
+
+    void* p = _arena.reallocate(ptr, new_size);
+    if (p) return p;
+
+    // block is exhausted, move data to parent's memory
+    p = _parent->allocate(new_size);
+    if (!p) return nullptr;
+    size_t old_size = Arena::blocksize(ptr);
+    std::memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    _arena.deallocate(ptr);
+    return p;
+}
+
+Allocator* allocator(subsys_t s){
+    static Allocator allocators[static_cast<size_t>(subsys_t::count)]{
+        Allocator(static_cast<policy_t>(EMBUI_MEM_POLICY_INTERFACE)),
+        Allocator(static_cast<policy_t>(EMBUI_MEM_POLICY)),
+        Allocator(static_cast<policy_t>(EMBUI_MEM_POLICY)),
+        Allocator(static_cast<policy_t>(EMBUI_MEM_POLICY)),
+        Allocator(static_cast<policy_t>(EMBUI_MEM_POLICY)),
+        Allocator(static_cast<policy_t>(EMBUI_MEM_POLICY))
+    };
+    return &allocators[static_cast<size_t>(s) % static_cast<size_t>(subsys_t::count)];
+}
+
+const char* name(subsys_t s){
+    switch (s){
+        case subsys_t::interface : return "interface";
+        case subsys_t::ingress : return "ingress";
+        case subsys_t::config : return "config";
+        case subsys_t::units : return "units";
+        case subsys_t::egress : return "egress";
+        case subsys_t::misc : return "misc";
+        default : return "";
+    }
+}
+
+} // namespace embui_mem
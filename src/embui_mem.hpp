@@ -0,0 +1,203 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <ArduinoJson.h>
+
+/**
+ * @brief memory allocators for EmbUI's JsonDocuments
+ * every JsonDocument created by EmbUI gets an allocator of the subsystem it belongs to,
+ * allocator places memory according to subsystem's policy and keeps byte counters,
+ * so that it is possible to see and control where UI memory goes
+ */
+namespace embui_mem {
+
+// memory placement policy
+enum class policy_t : uint8_t {
+    internal = 0,   // internal RAM only
+    psram,          // prefer PSRAM, fallback to internal RAM if there is no PSRAM or it's exhausted
+    arena           // bump allocator over a preallocated block, reset once all of it's allocations are released. Falls back to psram policy when exhausted
+};
+
+// EmbUI subsystems that allocate JsonDocuments
+enum class subsys_t : uint8_t {
+    interface = 0,  // Interface frames
+    ingress,        // incoming posts queue
+    config,         // system config
+    units,          // EmbUI units configs and presets
+    egress,         // outgoing frames conversion
+    misc,           // value cache, time API, etc...
+    count
+};
+
+// subsystem's memory counters
+struct stat_t {
+    // bytes currently allocated
+    size_t used;
+    // max bytes allocated
+    size_t peak;
+    // allocations made
+    uint32_t allocs;
+    // failed allocations
+    uint32_t fails;
+};
+
+/**
+ * @brief bump allocator over a memory block
+ * blocks are allocated sequentially, released space is not reused until all blocks are released,
+ * then arena is reset. The last block could be resized in place. Not thread-safe
+ */
+class Arena {
+    uint8_t *_base{nullptr};
+    size_t _size{0};
+    size_t _offset{0};
+    // offset of the last block
+    size_t _last{0};
+    // number of blocks not yet released
+    size_t _live{0};
+
+public:
+    Arena() = default;
+    Arena(void* buff, size_t size) : _base(static_cast<uint8_t*>(buff)), _size(size) {}
+
+    // set arena's memory block, should be called only when arena has no blocks allocated
+    void assign(void* buff, size_t size){ _base = static_cast<uint8_t*>(buff); _size = size; _offset = _last = _live = 0; }
+
+    bool valid() const { return _base; }
+    bool owns(const void* ptr) const { return ptr >= _base && ptr < _base + _size; }
+
+    /**
+     * @brief allocate a block
+     * @return void* block or nullptr if arena is exhausted
+     */
+    void* allocate(size_t size);
+
+    // release a block
+    void deallocate(void* ptr);
+
+    /**
+     * @brief resize a block
+     * the last block is resized in place, others are moved to a new block
+     * @return void* block or nullptr if arena is exhausted, original block stays valid then
+     */
+    void* reallocate(void* ptr, size_t new_size);
+
+    // bytes in use, including released blocks that wait for reset
+    size_t used() const { return _offset; }
+
+    // size of a block allocated from arena
+    static size_t blocksize(const void* ptr);
+};
+
+/**
+ * @brief ArduinoJson allocator with placement policy and byte counters
+ * memory is released according to it's origin, not current policy, so policy could be changed at any time
+ */
+class Allocator : public ArduinoJson::Allocator {
+    std::atomic<policy_t> _policy;
+    Arena _arena;
+    std::mutex _mtx;
+    std::atomic<size_t> _used{0};
+    std::atomic<size_t> _peak{0};
+    std::atomic<uint32_t> _allocs{0};
+    std::atomic<uint32_t> _fails{0};
+
+    void* _heap_alloc(size_t size, policy_t p);
+
+    // update counters
+    void _account(size_t add, size_t sub);
+
+public:
+    explicit Allocator(policy_t policy) : _policy(policy) {}
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t new_size) override;
+
+    /**
+     * @brief allocate a long-lived block from heap, arena is bypassed even with arena policy
+     * block is released with deallocate()
+     */
+    void* allocate_block(size_t size);
+
+    policy_t policy() const { return _policy; }
+
+    /**
+     * @brief set placement policy for new allocations
+     * arena memory is allocated on first use and kept for a lifetime
+     */
+    void policy(policy_t p){ _policy = p; }
+
+    stat_t stats() const { return { _used, _peak, _allocs, _fails }; }
+};
+
+/**
+ * @brief ArduinoJson allocator over a caller-provided buffer
+ * never uses heap, allocation fails when buffer is exhausted. Buffer space is reclaimed once
+ * document releases all of it's memory, i.e. on JsonDocument::clear(). Not thread-safe.
+ * ArduinoJson allocates document's memory in pools, buffer should fit at least one pool,
+ * that is about 1 KiB on ESP32
+ */
+class BufferAllocator : public ArduinoJson::Allocator {
+    Arena _arena;
+    size_t _peak{0};
+    uint32_t _allocs{0};
+    uint32_t _fails{0};
+
+public:
+    BufferAllocator(void* buff, size_t size) : _arena(buff, size) {}
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override { _arena.deallocate(ptr); }
+    void* reallocate(void* ptr, size_t new_size) override;
+
+    stat_t stats() const { return { _arena.used(), _peak, _allocs, _fails }; }
+};
+
+/**
+ * @brief ArduinoJson allocator for a document that is filled and cleared over and over, i.e. a queue slot
+ * memory block is allocated from parent allocator on first use and kept for a lifetime, it is reused once document
+ * releases all of it's memory, i.e. on JsonDocument::clear(). So a document that fits into the block does not touch heap,
+ * allocations that do not fit are passed to parent allocator. Not thread-safe
+ */
+class SlotAllocator : public ArduinoJson::Allocator {
+    embui_mem::Allocator* _parent;
+    size_t _size;
+    void* _block{nullptr};
+    Arena _arena;
+
+public:
+    SlotAllocator(embui_mem::Allocator* parent, size_t size) : _parent(parent), _size(size) {}
+    ~SlotAllocator(){ if (_block) _parent->deallocate(_block); }
+    SlotAllocator(const SlotAllocator&) = delete;
+    SlotAllocator& operator=(const SlotAllocator&) = delete;
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t new_size) override;
+};
+
+/**
+ * @brief get subsystem's allocator
+ * pointer should be passed to JsonDocument's constructor, i.e.
+ * JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::units));
+ */
+Allocator* allocator(subsys_t s);
+
+// get subsystem's memory counters
+inline stat_t stats(subsys_t s){ return allocator(s)->stats(); }
+
+// subsystem name
+const char* name(subsys_t s);
+
+} // namespace embui_mem
@@ -0,0 +1,320 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "ui.h"
+
+/**
+ * @brief compile-time UI page description
+ * static page skeleton (sections, labels, element types) is serialized to a json frame at compile time
+ * and placed into flash, at runtime it is sent as-is, only dynamic values are sent with a value frame.
+ * Elements produce same objects as Interface's methods with same names, except that element values are not included,
+ * ids of value-bearing elements are collected into the page's list instead.
+ * Strings must be compile-time constants, double quotes, backslashes and control chars are not allowed.
+ * Requires C++20
+ *
+ * Example:
+ *  static constexpr auto page_demo = embui_page::make<[]{
+ *      using namespace embui_page;
+ *      return frame(
+ *          section_main("demo", "Some demo controls",
+ *              comment("a set of controls"),
+ *              checkbox("vLED", "Onboard LED", true),
+ *              text("v1", "text field label"),
+ *              button(button_t::submit, "do_demo", "Send")
+ *          )
+ *      );
+ *  }>();
+ *
+ *  void block_demopage(Interface *interf, JsonVariantConst data, const char* action){
+ *      page_demo.send(interf);                             // static skeleton
+ *      page_demo.values(interf, embui.getConfig());        // dynamic values
+ *  }
+ */
+namespace embui_page {
+
+// page fragment
+struct node_t {
+    // serialized json
+    std::string json;
+    // ids of value-bearing elements, each one is '\0'-terminated
+    std::string ids;
+};
+
+// this function is not constexpr, calling it from constant evaluation fails compilation with a meaningful name
+inline void unsupported_char_in_page_string(){}
+
+// quoted json string
+constexpr std::string quote(std::string_view s){
+    std::string r(1, '"');
+    for (char c : s){
+        if (c == '"' || c == '\\' || (c >= 0 && c < 0x20))
+            unsupported_char_in_page_string();
+        r += c;
+    }
+    r += '"';
+    return r;
+}
+
+// json integer
+constexpr std::string number_str(long v){
+    if (!v) return "0";
+    std::string r;
+    bool neg = v < 0;
+    unsigned long u = neg ? 0UL - static_cast<unsigned long>(v) : static_cast<unsigned long>(v);
+    while (u){
+        r.insert(r.begin(), static_cast<char>('0' + u % 10));
+        u /= 10;
+    }
+    if (neg) r.insert(r.begin(), '-');
+    return r;
+}
+
+// "key":value pair with leading comma, value must be serialized json
+constexpr std::string kv(std::string_view key, std::string_view value){
+    std::string r(",");
+    r += quote(key);
+    r += ':';
+    r += value;
+    return r;
+}
+
+// "key":"string" pair with leading comma
+constexpr std::string kvs(std::string_view key, std::string_view value){ return kv(key, quote(value)); }
+
+/**
+ * @brief make an element object
+ *
+ * @param fields comma-prefixed serialized key/value pairs
+ * @param id element's id, added to value ids if not empty
+ */
+constexpr node_t element(std::string fields, std::string_view id = {}){
+    node_t n;
+    fields[0] = '{';
+    n.json = fields + '}';
+    if (!id.empty()){
+        n.ids = id;
+        n.ids += '\0';
+    }
+    return n;
+}
+
+// join nodes into a block array
+template <typename... N>
+constexpr node_t block(const N&... nodes){
+    node_t n;
+    n.json = "[";
+    ((n.json += nodes.json, n.json += ',', n.ids += nodes.ids), ...);
+    if (n.json.back() == ',') n.json.pop_back();
+    n.json += ']';
+    return n;
+}
+
+/**
+ * @brief section object
+ * mirrors Interface::json_section_begin()
+ */
+template <typename... N>
+constexpr node_t section_begin(std::string_view id, std::string_view label, bool main, bool hidden, bool line, const N&... nodes){
+    std::string f = kvs(P_section, id);
+    if (!label.empty()) f += kvs(P_label, label);
+    if (main) f += kv(P_main, "true");
+    if (hidden) f += kv(P_hidden, "true");
+    if (line) f += kv(P_line, "true");
+    node_t b = block(nodes...);
+    f += kv(P_block, b.json);
+    node_t n = element(f);
+    n.ids = b.ids;
+    return n;
+}
+
+template <typename... N>
+constexpr node_t section(std::string_view id, const N&... nodes){ return section_begin(id, {}, false, false, false, nodes...); }
+
+template <typename... N>
+constexpr node_t section(std::string_view id, std::string_view label, const N&... nodes){ return section_begin(id, label, false, false, false, nodes...); }
+
+template <typename... N>
+constexpr node_t section_main(std::string_view id, std::string_view label, const N&... nodes){ return section_begin(id, label, true, false, false, nodes...); }
+
+template <typename... N>
+constexpr node_t section_hidden(std::string_view id, std::string_view label, const N&... nodes){ return section_begin(id, label, false, true, false, nodes...); }
+
+template <typename... N>
+constexpr node_t section_line(std::string_view id, const N&... nodes){ return section_begin(id, {}, false, false, true, nodes...); }
+
+template <typename... N>
+constexpr node_t section_content(const N&... nodes){ return section(P_content, nodes...); }
+
+/**
+ * @brief root of the "interface" frame
+ * frame is a complete one, i.e. it is sent with "final" flag
+ */
+template <typename... N>
+constexpr node_t frame(const N&... nodes){
+    std::string f = kvs(P_pkg, P_interface);
+    f += kv(P_final, "true");
+    f += kvs(P_section, "page");
+    node_t b = block(nodes...);
+    f += kv(P_block, b.json);
+    node_t n = element(f);
+    n.ids = b.ids;
+    return n;
+}
+
+// generic html input, mirrors Interface::html_input()
+constexpr node_t input(std::string_view id, std::string_view type, std::string_view label, bool onChange = false){
+    std::string f = kvs(P_html, P_input) + kvs(P_id, id) + kvs(P_type, type) + kvs(P_label, label);
+    if (onChange) f += kv(P_onChange, "true");
+    return element(f, id);
+}
+
+// same as input() but with a static value
+constexpr node_t input(std::string_view id, std::string_view type, std::string_view value, std::string_view label, bool onChange){
+    std::string f = kvs(P_html, P_input) + kvs(P_id, id) + kvs(P_type, type) + kvs(P_label, label) + kvs(P_value, value);
+    if (onChange) f += kv(P_onChange, "true");
+    return element(f);
+}
+
+constexpr node_t text(std::string_view id, std::string_view label){ return input(id, P_text, label); }
+
+// text field with a static value, it is not filled with page values
+constexpr node_t text(std::string_view id, std::string_view value, std::string_view label){ return input(id, P_text, value, label, false); }
+
+constexpr node_t password(std::string_view id, std::string_view label){ return input(id, P_password, label); }
+
+constexpr node_t checkbox(std::string_view id, std::string_view label, bool onChange = false){ return input(id, P_chckbox, label, onChange); }
+
+constexpr node_t color(std::string_view id, std::string_view label){ return input(id, P_color, label); }
+
+constexpr node_t date(std::string_view id, std::string_view label, bool onChange = false){ return input(id, P_date, label, onChange); }
+
+constexpr node_t time(std::string_view id, std::string_view label, bool onChange = false){ return input(id, P_time, label, onChange); }
+
+// mirrors Interface::number_constrained(), integer constraints only
+constexpr node_t number(std::string_view id, std::string_view label, long step = 0, long min = 0, long max = 0){
+    std::string f = kvs(P_html, P_input) + kvs(P_id, id) + kvs(P_label, label);
+    if (min) f += kv(P_min, number_str(min));
+    if (max) f += kv(P_max, number_str(max));
+    if (step) f += kv(P_step, number_str(step));
+    return element(f, id);
+}
+
+// mirrors Interface::range(), integer constraints only
+constexpr node_t range(std::string_view id, long min, long max, long step, std::string_view label, bool onChange = false){
+    std::string f = kvs(P_html, P_input) + kvs(P_id, id) + kvs(P_type, P_range) + kvs(P_label, label)
+        + kv(P_min, number_str(min)) + kv(P_max, number_str(max)) + kv(P_step, number_str(step));
+    if (onChange) f += kv(P_onChange, "true");
+    return element(f, id);
+}
+
+constexpr node_t textarea(std::string_view id, std::string_view label){
+    return element(kvs(P_html, P_textarea) + kvs(P_id, id) + kvs(P_label, label), id);
+}
+
+// mirrors Interface::comment()
+constexpr node_t comment(std::string_view label){ return element(kvs(P_html, P_comment) + kv(P_id, "null") + kvs(P_label, label)); }
+
+// mirrors Interface::constant(), value is filled at runtime
+constexpr node_t constant(std::string_view id, std::string_view label){ return element(kvs(P_html, P_comment) + kvs(P_id, id) + kvs(P_label, label), id); }
+
+constexpr node_t spacer(std::string_view label = {}){ return element(kvs(P_html, P_spacer) + kvs(P_label, label)); }
+
+// select's option
+constexpr node_t option(long value, std::string_view label){ return element(kvs(P_label, label) + kv(P_value, number_str(value))); }
+constexpr node_t option(std::string_view value, std::string_view label){ return element(kvs(P_label, label) + kvs(P_value, value)); }
+
+// mirrors Interface::select() with nested options section
+template <typename... N>
+constexpr node_t select(std::string_view id, std::string_view label, bool onChange, const N&... options){
+    std::string f = kvs(P_html, P_select) + kvs(P_id, id) + kvs(P_label, label);
+    if (onChange) f += kv(P_onChange, "true");
+    f += kvs(P_section, P_options);
+    f += kv(P_block, block(options...).json);
+    return element(f, id);
+}
+
+// mirrors Interface::button()
+constexpr node_t button(button_t btype, std::string_view id, std::string_view label, std::string_view color = {}){
+    std::string f = kvs(P_html, P_button) + kv(P_type, number_str(static_cast<long>(btype))) + kvs(P_id, id) + kvs(P_label, label);
+    if (!color.empty()) f += kvs(P_color, color);
+    return element(f);
+}
+
+// mirrors Interface::button_value(), value is static
+constexpr node_t button_value(button_t btype, std::string_view id, long value, std::string_view label, std::string_view color = {}){
+    node_t n = button(btype, id, label, color);
+    n.json.pop_back();
+    n.json += kv(P_value, number_str(value)) + '}';
+    return n;
+}
+
+/**
+ * @brief serialized page
+ *
+ * @tparam L length of layout including terminating '\0'
+ * @tparam I length of ids list
+ */
+template <size_t L, size_t I>
+struct page_t {
+    std::array<char, L> layout;
+    std::array<char, I> ids;
+
+    constexpr const char* c_str() const { return layout.data(); }
+    constexpr size_t size() const { return L - 1; }
+
+    // send page's skeleton frame
+    void send(Interface *interf) const {
+        if (interf) interf->json_frame_static(layout.data(), L - 1);
+    }
+
+    /**
+     * @brief send page's values in a value frame
+     * values for page's elements are looked up by element's id in src object, missing ones are skipped
+     *
+     * @param interf
+     * @param src object with values, i.e. EmbUI's config
+     */
+    void values(Interface *interf, JsonVariantConst src) const {
+        if (!interf) return;
+        interf->json_frame_value();
+        for (const char* id = ids.data(); id < ids.data() + I && *id; id += std::strlen(id) + 1){
+            JsonVariantConst v = src[id];
+            if (!v.isNull())
+                interf->value(id, v);
+        }
+        interf->json_frame_flush();
+    }
+};
+
+/**
+ * @brief serialize page at compile time
+ *
+ * @tparam Builder a lambda or function returning page's frame() node
+ */
+template <auto Builder>
+consteval auto make(){
+    constexpr size_t l = Builder().json.size() + 1;
+    constexpr size_t i = Builder().ids.size() + 1;
+    page_t<l, i> p{};
+    node_t n = Builder();
+    for (size_t k = 0; k != n.json.size(); ++k)
+        p.layout[k] = n.json[k];
+    for (size_t k = 0; k != n.ids.size(); ++k)
+        p.ids[k] = n.ids[k];
+    return p;
+}
+
+} // namespace embui_page
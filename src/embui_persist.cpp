@@ -0,0 +1,121 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include <Arduino.h>
+#include <string>
+#include <string_view>
+#include "embui_persist.hpp"
+#include "embui_fswriter.hpp"
+#include "embui_log.h"
+
+PersistManager::PersistManager(){
+    _tPersist.set(EMBUI_PERSIST_TICK_MS * TASK_MILLISECOND, TASK_FOREVER, [this](){ _run(); });
+}
+
+void PersistManager::dirty(const char* id, writer_t writer, uint32_t delay){
+    if (!id || !writer) return;
+    uint32_t now = millis();
+    auto &i = _items[id];
+    if (!i.writer) i.dirty_since = now;
+    i.writer = std::move(writer);
+    i.touched = now;
+    i.delay = delay;
+    ++i.stat.marks;
+
+    if (!_task_added){
+        ts.addTask(_tPersist);
+        _task_added = true;
+    }
+    _tPersist.enableIfNot();
+}
+
+size_t PersistManager::_write(item_t& i){
+    // writer is released before execution, so that it could mark the object dirty again
+    writer_t w(std::move(i.writer));
+    i.writer = nullptr;
+    size_t n = w();
+    i.last_write = millis();
+    if (n){
+        ++i.stat.writes;
+        i.stat.bytes += n;
+    }
+    return n;
+}
+
+void PersistManager::_run(){
+    uint32_t now = millis();
+    bool pending{false};
+    for (auto &[id, i] : _items){
+        if (!i.writer) continue;
+        // debounce, but do not postpone a write for too long if object keeps changing
+        bool due = now - i.touched >= i.delay || now - i.dirty_since >= EMBUI_PERSIST_MAX_DELAY;
+        // space out writes of the same object
+        if (due && i.stat.writes && now - i.last_write < EMBUI_PERSIST_MIN_INTERVAL) due = false;
+        if (!due){
+            pending = true;
+            continue;
+        }
+        size_t n = _write(i);
+        LOGD(P_EmbUI, printf, "persist %s: %u bytes\n", id.c_str(), n);
+    }
+    if (!pending) _tPersist.disable();
+}
+
+size_t PersistManager::flush(const char* id){
+    size_t n{0};
+    if (id){
+        auto i = _items.find(id);
+        if (i != _items.end() && i->second.writer)
+            n = _write(i->second);
+#if EMBUI_FS_ASYNC
+        // wait for object's background file write, ids are file names optionally followed by "#{subid}"
+        std::string_view path(id);
+        FSWriter::getInstance().sync(std::string(path.substr(0, path.find((char)0x23))).c_str());
+#endif
+        return n;
+    }
+
+    for (auto &[k, i] : _items)
+        if (i.writer) n += _write(i);
+#if EMBUI_FS_ASYNC
+    // make sure background writes have landed, i.e. before reboot
+    FSWriter::getInstance().sync();
+#endif
+    LOGD(P_EmbUI, printf, "persist flush: %u bytes\n", n);
+    return n;
+}
+
+void PersistManager::discard(const char* id){
+    if (!id) return;
+    auto i = _items.find(id);
+    if (i != _items.end())
+        i->second.writer = nullptr;
+}
+
+bool PersistManager::pending() const {
+    for (const auto &[id, i] : _items)
+        if (i.writer) return true;
+    return false;
+}
+
+PersistManager::stat_t PersistManager::stats(const char* id) const {
+    if (!id) return {};
+    auto i = _items.find(id);
+    return i == _items.end() ? stat_t{} : i->second.stat;
+}
+
+void PersistManager::report(JsonObject obj) const {
+    for (const auto &[id, i] : _items){
+        JsonObject o = obj[id].to<JsonObject>();
+        o["writes"] = i.stat.writes;
+        o["bytes"] = i.stat.bytes;
+        o["marks"] = i.stat.marks;
+    }
+}
@@ -0,0 +1,126 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <ArduinoJson.h>
+#include "embui_defines.h"
+#include "ts.h"
+
+/**
+ * @brief write-behind persistence manager
+ * objects that need to be saved to flash (system config, unit configs, presets) are marked dirty with a writer function
+ * instead of being written right away. Marks for the same id are coalesced, the latest writer is executed once
+ * the object was not changed for a given delay, but not later than EMBUI_PERSIST_MAX_DELAY since it became dirty.
+ * Consecutive writes of the same id are spaced at least EMBUI_PERSIST_MIN_INTERVAL apart. Pending writes are flushed
+ * on reboot. Writers are executed on EmbUI's task, manager must be used from that task only.
+ * Manager accounts writes and bytes written per id, so that flash wear could be tracked.
+ *
+ * Example:
+ *  PersistManager::getInstance().dirty("/my.json", [](){ return embuifs::serialize2fileAtomic(doc, "/my.json"); });
+ */
+class PersistManager {
+public:
+    /**
+     * @brief writer function
+     * @return size_t number of bytes written to flash, 0 if nothing was written
+     */
+    using writer_t = std::function< size_t (void)>;
+
+    struct stat_t {
+        // number of writes
+        uint32_t writes;
+        // bytes written
+        uint32_t bytes;
+        // number of dirty marks, marks - writes is a number of coalesced writes
+        uint32_t marks;
+    };
+
+private:
+    struct item_t {
+        // pending writer, empty if object is clean
+        writer_t writer;
+        // time object became dirty, ms
+        uint32_t dirty_since;
+        // time of last mark, ms
+        uint32_t touched;
+        // debounce delay, ms
+        uint32_t delay;
+        // time of last write, ms
+        uint32_t last_write;
+        stat_t stat;
+    };
+
+    std::map<std::string, item_t> _items;
+    Task _tPersist;
+    bool _task_added{false};
+
+    PersistManager();
+
+    // write objects that are due
+    void _run();
+
+    // execute pending writer
+    size_t _write(item_t& i);
+
+public:
+    // this is a singleton
+    PersistManager(PersistManager const&) = delete;
+    void operator=(PersistManager const&) = delete;
+
+    /**
+     * obtain a reference to singleton instance
+     */
+    static PersistManager& getInstance(){
+        static PersistManager inst;
+        return inst;
+    }
+
+    /**
+     * @brief mark object dirty
+     * replaces previously registered writer for the same id
+     *
+     * @param id object id, i.e. file name
+     * @param writer function that writes object and returns number of bytes written
+     * @param delay debounce delay, ms, each mark postpones the write
+     */
+    void dirty(const char* id, writer_t writer, uint32_t delay = EMBUI_PERSIST_DELAY);
+
+    /**
+     * @brief write pending object right away, minimal write interval is ignored
+     * background file writes are waited for, so object's data is on flash on return.
+     * For an id like "{file}#{subid}" the write of {file} is waited for
+     *
+     * @param id object id, nullptr - write all pending objects
+     * @return size_t bytes written
+     */
+    size_t flush(const char* id = nullptr);
+
+    /**
+     * @brief drop pending write, i.e. if object's file was removed
+     */
+    void discard(const char* id);
+
+    // check if there are pending writes
+    bool pending() const;
+
+    /**
+     * @brief get write statistics for object
+     */
+    stat_t stats(const char* id) const;
+
+    /**
+     * @brief fill object with write statistics per id, {"id":{"writes":n, "bytes":n, "marks":n}}
+     */
+    void report(JsonObject obj) const;
+};
@@ -0,0 +1,190 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include <algorithm>
+#include <cstring>
+#include "embui_presets.hpp"
+#include "esp_rom_crc.h"
+#include "embui_log.h"
+
+static constexpr const char* T_tmp_suffix = ".tmp";
+
+// space allocated for a record, rounded up so that slightly grown config still fits in place
+static uint32_t record_cap(uint32_t size){ return (size + EMBUI_PRESET_SLACK - 1) / EMBUI_PRESET_SLACK * EMBUI_PRESET_SLACK; }
+
+bool PresetStore::begin(const char* path){
+    if (!path || !*path) return false;
+    _path = path;
+    _ready = false;
+
+    // leftover of interrupted compaction, store file is intact until temp file is renamed
+    String tmp(path);
+    tmp += T_tmp_suffix;
+    if (LittleFS.exists(tmp)) LittleFS.remove(tmp);
+
+    if (!LittleFS.exists(path))
+        return (_ready = _create());
+
+    File f = LittleFS.open(path, "r");
+    header_t h{};
+    if (!f || f.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) != sizeof(h) || h.magic != _magic || h.version != _version){
+        LOGE(P_EmbUI, printf, "presets store %s is damaged, recreating\n", path);
+        f.close();
+        return (_ready = _create());
+    }
+
+    std::fill(_idx.begin(), _idx.end(), entry_t{});
+    size_t n = std::min<size_t>(h.count, _idx.size());
+    if (f.read(reinterpret_cast<uint8_t*>(_idx.data()), n * sizeof(entry_t)) != n * sizeof(entry_t)){
+        LOGE(P_EmbUI, printf, "presets store %s index is damaged, recreating\n", path);
+        f.close();
+        return (_ready = _create());
+    }
+    f.close();
+    for (auto &e : _idx)
+        e.label[sizeof(e.label) - 1] = 0;
+
+    _hdr = h;
+    _ready = true;
+    if (h.count == _idx.size()) return true;
+
+    // number of slots has changed, rewrite the file with a new index size, presets beyond new size are dropped
+    LOGI(P_EmbUI, printf, "resizing presets store %s: %u -> %u\n", path, h.count, _idx.size());
+    return compact();
+}
+
+bool PresetStore::_create(){
+    std::fill(_idx.begin(), _idx.end(), entry_t{});
+    _hdr = { _magic, _version, static_cast<uint16_t>(_idx.size()), 0, static_cast<uint32_t>(_data_start()), 0 };
+    File f = LittleFS.open(_path.c_str(), "w");
+    if (!f){
+        LOGE(P_EmbUI, printf, "can't create presets store %s\n", _path.c_str());
+        return false;
+    }
+    size_t len = _idx.size() * sizeof(entry_t);
+    return f.write(reinterpret_cast<const uint8_t*>(&_hdr), sizeof(_hdr)) == sizeof(_hdr) &&
+        f.write(reinterpret_cast<const uint8_t*>(_idx.data()), len) == len;
+}
+
+bool PresetStore::_write_index(File& f, size_t idx){
+    return f.seek(0) && f.write(reinterpret_cast<const uint8_t*>(&_hdr), sizeof(_hdr)) == sizeof(_hdr) &&
+        f.seek(_entry_pos(idx)) && f.write(reinterpret_cast<const uint8_t*>(&_idx[idx]), sizeof(entry_t)) == sizeof(entry_t);
+}
+
+DeserializationError PresetStore::load(size_t idx, JsonDocument& doc){
+    if (!_ready || !exist(idx)) return DeserializationError::Code::EmptyInput;
+    const entry_t &e = _idx[idx];
+
+    File f = LittleFS.open(_path.c_str(), "r");
+    std::vector<uint8_t> buff(e.size);
+    if (!f || !f.seek(e.offset) || f.read(buff.data(), e.size) != e.size)
+        return DeserializationError::Code::InvalidInput;
+
+    if (esp_rom_crc32_le(0, buff.data(), e.size) != e.crc){
+        LOGE(P_EmbUI, printf, "preset %u crc mismatch in %s\n", idx, _path.c_str());
+        return DeserializationError::Code::InvalidInput;
+    }
+    return deserializeMsgPack(doc, static_cast<const uint8_t*>(buff.data()), e.size);
+}
+
+size_t PresetStore::save(size_t idx, const char* label, JsonVariantConst cfg){
+    if (!_ready || idx >= _idx.size()) return 0;
+
+    entry_t e = _idx[idx];
+    std::memset(e.label, 0, sizeof(e.label));
+    if (label) std::strncpy(e.label, label, sizeof(e.label) - 1);
+
+    std::vector<uint8_t> buff(measureMsgPack(cfg));
+    e.size = serializeMsgPack(cfg, buff.data(), buff.size());
+    e.crc = esp_rom_crc32_le(0, buff.data(), e.size);
+
+    // do not wear flash if nothing has changed
+    bool same = _idx[idx].size == e.size && _idx[idx].crc == e.crc && !std::memcmp(_idx[idx].label, e.label, sizeof(e.label));
+    if (same && _hdr.last == static_cast<int32_t>(idx)) return 0;
+
+    header_t h = _hdr;
+    h.last = idx;
+    if (!same && e.size > e.cap){
+        // relocate record to the end of file, it is padded to allocated space so that file always ends at 'end'
+        h.garbage += e.cap;
+        e.offset = h.end;
+        e.cap = record_cap(e.size);
+        h.end += e.cap;
+        buff.resize(e.cap);
+    }
+
+    File f = LittleFS.open(_path.c_str(), "r+");
+    if (!f) return 0;
+    size_t written = same ? 0 : buff.size();
+    if (written && (!f.seek(e.offset) || f.write(buff.data(), buff.size()) != buff.size())){
+        LOGE(P_EmbUI, printf, "failed to write preset %u to %s\n", idx, _path.c_str());
+        return 0;
+    }
+
+    // index entry is written after the record, so a relocated record replaces old one only when it is complete
+    _hdr = h;
+    _idx[idx] = e;
+    bool ok = _write_index(f, idx);
+    f.close();
+
+    if (!ok) return 0;
+    written += sizeof(_hdr) + sizeof(entry_t);
+
+    if (_hdr.garbage > (_hdr.end - _data_start()) / 2 && compact())
+        written += _hdr.end;
+    return written;
+}
+
+bool PresetStore::compact(){
+    if (!_ready) return false;
+
+    // new layout, records are placed back to back in slots order
+    std::vector<entry_t> idx(_idx);
+    header_t h{ _magic, _version, static_cast<uint16_t>(idx.size()), _hdr.last, static_cast<uint32_t>(_data_start()), 0 };
+    for (auto &e : idx){
+        if (!e.size){
+            e.offset = e.cap = e.crc = 0;
+            continue;
+        }
+        e.offset = h.end;
+        e.cap = record_cap(e.size);
+        h.end += e.cap;
+    }
+
+    String tmp(_path.c_str());
+    tmp += T_tmp_suffix;
+    File src = LittleFS.open(_path.c_str(), "r");
+    File dst = LittleFS.open(tmp, "w");
+    bool ok = src && dst;
+    size_t len = idx.size() * sizeof(entry_t);
+    ok = ok && dst.write(reinterpret_cast<const uint8_t*>(&h), sizeof(h)) == sizeof(h) &&
+        dst.write(reinterpret_cast<const uint8_t*>(idx.data()), len) == len;
+
+    std::vector<uint8_t> buff;
+    for (size_t i = 0; ok && i != idx.size(); ++i){
+        if (!idx[i].size) continue;
+        buff.assign(idx[i].cap, 0);
+        ok = src.seek(_idx[i].offset) && src.read(buff.data(), idx[i].size) == idx[i].size &&
+            dst.write(buff.data(), buff.size()) == buff.size();
+    }
+    src.close();
+    dst.close();
+
+    if (!ok || !LittleFS.rename(tmp, _path.c_str())){
+        LOGE(P_EmbUI, printf, "failed to compact presets store %s\n", _path.c_str());
+        LittleFS.remove(tmp);
+        return false;
+    }
+
+    _hdr = h;
+    _idx = std::move(idx);
+    LOGD(P_EmbUI, printf, "compacted presets store %s, %u bytes\n", _path.c_str(), _hdr.end);
+    return true;
+}
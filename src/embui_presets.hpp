@@ -0,0 +1,135 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include "embui_defines.h"
+
+/**
+ * @brief storage for Unit's configuration presets with random access to each preset
+ * all presets are kept in a single file that starts with a header and a fixed-size index table followed by preset records.
+ * Index entry holds preset's label, record's offset, size and CRC, the whole index is loaded to RAM on begin().
+ * Loading a preset reads only it's record, saving a preset rewrites only it's record and index entry,
+ * so preset switch time does not depend on a number of presets.
+ * A record is rewritten in place if it fits into space allocated for it, otherwise it is appended to the end of file,
+ * space left by relocated records is reclaimed by compact(), which is started automatically when it exceeds half of the file.
+ * Records are stored as MessagePack, a record with CRC mismatch (i.e. interrupted in-place write) is treated as empty
+ */
+class PresetStore {
+public:
+    // index entry, same layout in RAM and on disk
+    struct entry_t {
+        // preset's label, empty if not set
+        char label[EMBUI_PRESET_LABEL_LEN];
+        // record's offset in file
+        uint32_t offset;
+        // record's size, 0 - empty preset
+        uint32_t size;
+        // space allocated for the record
+        uint32_t cap;
+        // record's crc32
+        uint32_t crc;
+    };
+
+private:
+    static constexpr uint32_t _magic = 0x50495545;     // "EUIP"
+    static constexpr uint16_t _version = 1;
+
+    struct header_t {
+        uint32_t magic;
+        uint16_t version;
+        // number of index entries
+        uint16_t count;
+        // last saved preset
+        int32_t last;
+        // end of data
+        uint32_t end;
+        // bytes held by relocated records
+        uint32_t garbage;
+    };
+
+    std::string _path;
+    header_t _hdr{};
+    std::vector<entry_t> _idx;
+    bool _ready{false};
+
+    static constexpr size_t _entry_pos(size_t idx){ return sizeof(header_t) + idx * sizeof(entry_t); }
+    size_t _data_start() const { return _entry_pos(_idx.size()); }
+
+    // create an empty store file
+    bool _create();
+
+    // write header and index entry
+    bool _write_index(File& f, size_t idx);
+
+public:
+    /**
+     * @param count number of preset slots
+     */
+    explicit PresetStore(size_t count) : _idx(count) {}
+
+    /**
+     * @brief open store and load it's index to RAM
+     * an empty store is created if file does not exist or is damaged,
+     * store is resized if it was created with a different number of slots
+     *
+     * @param path store file's path
+     * @return true if store is ready
+     */
+    bool begin(const char* path);
+
+    bool ready() const { return _ready; }
+
+    // number of preset slots
+    size_t count() const { return _idx.size(); }
+
+    // last saved preset number
+    int32_t last() const { return _hdr.last >= 0 && static_cast<size_t>(_hdr.last) < _idx.size() ? _hdr.last : 0; }
+
+    // check if preset has a saved config
+    bool exist(size_t idx) const { return idx < _idx.size() && _idx[idx].size; }
+
+    /**
+     * @brief get preset's label
+     * @return const char* label or nullptr if not set
+     */
+    const char* label(size_t idx) const { return idx < _idx.size() && *_idx[idx].label ? _idx[idx].label : nullptr; }
+
+    /**
+     * @brief load preset's config, reads preset's record only
+     *
+     * @param idx preset number
+     * @param doc destination document
+     * @return DeserializationError, EmptyInput if preset is empty, InvalidInput if it's record is damaged
+     */
+    DeserializationError load(size_t idx, JsonDocument& doc);
+
+    /**
+     * @brief save preset's config, rewrites preset's record and index entry only
+     * store header is updated with last saved preset number
+     *
+     * @param idx preset number
+     * @param label preset's label, truncated to EMBUI_PRESET_LABEL_LEN - 1 chars
+     * @param cfg config object
+     * @return size_t number of bytes written, 0 if nothing was written or write has failed
+     */
+    size_t save(size_t idx, const char* label, JsonVariantConst cfg);
+
+    /**
+     * @brief rewrite store file dropping space of relocated records
+     *
+     * @return true on success
+     */
+    bool compact();
+};
@@ -0,0 +1,158 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief bounded lock-free single-producer/single-consumer ring queue
+ * queue slots are preallocated, producer fills a slot in-place via acquire() and publishes it with commit(),
+ * consumer processes a slot in-place via front() and releases it with pop()
+ *
+ * @tparam T slot type
+ * @tparam N queue capacity, must be a power of 2
+ */
+template <typename T, size_t N>
+class SPSCQueue {
+    static_assert(N && !(N & (N - 1)), "queue capacity must be a power of 2");
+
+    std::array<T, N> _slots;
+    // free-running write/read counters
+    std::atomic<size_t> _head{0};
+    std::atomic<size_t> _tail{0};
+
+public:
+    /**
+     * @brief get a free slot to fill-in (producer side)
+     *
+     * @return T* pointer to a slot or nullptr if queue is full
+     */
+    T* acquire(){
+        size_t h = _head.load(std::memory_order_relaxed);
+        if (h - _tail.load(std::memory_order_acquire) == N)
+            return nullptr;
+        return &_slots[h & (N - 1)];
+    }
+
+    /**
+     * @brief publish a slot obtained with acquire() to consumer
+     */
+    void commit(){ _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /**
+     * @brief get the oldest published slot (consumer side)
+     *
+     * @return T* pointer to a slot or nullptr if queue is empty
+     */
+    T* front(){
+        size_t t = _tail.load(std::memory_order_relaxed);
+        if (t == _head.load(std::memory_order_acquire))
+            return nullptr;
+        return &_slots[t & (N - 1)];
+    }
+
+    /**
+     * @brief release a slot obtained with front() back to producer
+     */
+    void pop(){ _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // number of published slots
+    size_t size() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+
+    constexpr size_t capacity() const { return N; }
+};
+
+/**
+ * @brief bounded lock-free multi-producer/single-consumer ring queue
+ * any number of tasks could push to the queue concurrently, a single task consumes it.
+ * Each slot has a sequence counter, producers reserve a slot with CAS on the write counter, fill it
+ * and publish it by advancing slot's sequence, so a producer never waits for the others.
+ * Consumer processes a slot in-place via front() and releases it with pop()
+ *
+ * @tparam T slot type, must be copy-assignable
+ * @tparam N queue capacity, must be a power of 2
+ */
+template <typename T, size_t N>
+class MPSCQueue {
+    static_assert(N && !(N & (N - 1)), "queue capacity must be a power of 2");
+
+    struct cell_t {
+        // slot's sequence, equals write counter when slot is free, write counter + 1 when slot is published
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    std::array<cell_t, N> _cells;
+    // free-running write/read counters
+    std::atomic<size_t> _head{0};
+    std::atomic<size_t> _tail{0};
+
+public:
+    MPSCQueue(){
+        for (size_t i = 0; i != N; ++i)
+            _cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief push a copy of an item to queue (producer side, could be called from any task)
+     *
+     * @return false if queue is full
+     */
+    bool push(const T& item){
+        size_t pos = _head.load(std::memory_order_relaxed);
+        cell_t *c;
+        for (;;){
+            c = &_cells[pos & (N - 1)];
+            intptr_t dif = static_cast<intptr_t>(c->seq.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos);
+            if (!dif){
+                // slot is free, try to reserve it
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (dif < 0)
+                return false;
+            else
+                // other producer took this slot
+                pos = _head.load(std::memory_order_relaxed);
+        }
+        c->data = item;
+        c->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief get the oldest published slot (consumer side)
+     *
+     * @return T* pointer to a slot or nullptr if queue is empty or the oldest slot is still being filled by producer
+     */
+    T* front(){
+        size_t t = _tail.load(std::memory_order_relaxed);
+        cell_t &c = _cells[t & (N - 1)];
+        if (c.seq.load(std::memory_order_acquire) != t + 1)
+            return nullptr;
+        return &c.data;
+    }
+
+    /**
+     * @brief release a slot obtained with front() back to producers
+     */
+    void pop(){
+        size_t t = _tail.load(std::memory_order_relaxed);
+        _cells[t & (N - 1)].seq.store(t + N, std::memory_order_release);
+        _tail.store(t + 1, std::memory_order_release);
+    }
+
+    // number of reserved slots, including the ones that producers are still filling
+    size_t size() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+
+    constexpr size_t capacity() const { return N; }
+};
@@ -20,6 +20,9 @@
 
 #include "EmbUI.h"
 #include "embui_units.hpp"
+#include "embui_framecache.hpp"
+#include "embui_generator.hpp"
+#include "embui_persist.hpp"
 #include "nvs_handle.hpp"
 #include "embui_log.h"
 
@@ -41,30 +44,54 @@ void EmbUIUnit::setConfig(JsonVariantConst cfg){
 }
 
 void EmbUIUnit::load(){
-  JsonDocument doc;
-  embuifs::deserializeFile(doc, mkFileName().c_str());
-  load_cfg(  use_shared_file ? doc[label] : doc);
+  String fname(mkFileName());
+  // pending write must land first, otherwise stale config would be loaded
+  PersistManager::getInstance().flush(_cfg_id().c_str());
+  JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::units));
+  if (use_shared_file){
+    // shared file keeps configs of all units, pick only this unit's object
+    load_cfg(embuifs::query(doc, fname.c_str(), label));
+  } else {
+    embuifs::deserializeFileAtomic(doc, fname.c_str());
+    load_cfg(doc);
+  }
   start();
 }
 
 void EmbUIUnit::save(){
-  JsonDocument doc;
-  embuifs::deserializeFile(doc, mkFileName().c_str());
-  if (doc.isNull())
-    doc.to<JsonObject>();
-
-  JsonObject o;
-  if (  use_shared_file){
-    o = doc[label].isNull() ? doc[label].to<JsonObject>() : doc[label];
-  } else 
-    o = doc.as<JsonObject>();
+  // snapshot current config, unit might be destroyed before the write
+  auto cfg = std::make_shared<JsonDocument>(embui_mem::allocator(embui_mem::subsys_t::units));
+  getConfig(cfg->to<JsonObject>());
+
+  String fname(mkFileName());
+  // each unit of a shared file has it's own pending write, the writers merge their objects into the file one by one
+  PersistManager::getInstance().dirty(_cfg_id().c_str(), [cfg, fname, lbl = std::string(label), shared = use_shared_file](){
+    LOGD(P_Unit, printf, "writing cfg to file: %s\n", fname.c_str());
+    if (!shared)
+      return embuifs::serialize2fileAsync(*cfg, fname.c_str());
+
+    // shared file keeps other objects, it has to be merged
+    JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::units));
+    embuifs::deserializeFileAtomic(doc, fname.c_str());
+    if (!doc.is<JsonObject>())
+      doc.to<JsonObject>();
+    doc[lbl].set(*cfg);
+    return embuifs::serialize2fileAsync(doc, fname.c_str());
+  });
+  // unit's config has been changed, cached pages might be outdated
+  FrameCache::getInstance().invalidate();
+}
 
-  getConfig(  use_shared_file ? doc[label].to<JsonObject>() : doc.to<JsonObject>());
-  LOGD(P_Unit, printf, "writing cfg to file: %s\n", mkFileName().c_str());
-  embuifs::serialize2file(doc, mkFileName().c_str());
+std::string EmbUIUnit::_cfg_id(){
+  std::string id(mkFileName().c_str());
+  if (use_shared_file){
+    id += (char)0x23;   // '#' char
+    id += label;
+  }
+  return id;
 }
 
-String EmbUIUnit::mkFileName(const char* id, const char* path){
+String EmbUIUnit::mkFileName(const char* id, const char* path, const char* ext){
   String fname( path );
   // append namespace prefix if set
   if (ns){
@@ -82,7 +109,7 @@ String EmbUIUnit::mkFileName(const char* id, const char* path){
     fname += label;
   }
 
-  fname += ".json";
+  fname += ext;
   return fname;
 }
 
@@ -115,7 +142,7 @@ void EmbUIUnit::mkEmbUIpage(Interface *interf, JsonVariantConst data, const char
   interf->uidata_pick( key.c_str() );
   interf->json_frame_flush();
   // serialize and send unit's configuration as a 'value' frame
-  JsonDocument doc;
+  JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::units));
   getConfig(doc.to<JsonObject>());
   interf->json_frame_value(doc);
 
@@ -140,62 +167,102 @@ void EmbUIUnit::mkEmbUIpage(Interface *interf, JsonVariantConst data, const char
 
 // ****  EmbUIUnit_Presets methods
 
+bool EmbUIUnit_Presets::_open_store(){
+  if (_store->ready()) return true;
+
+  // a previous instance of this unit might have left pending writes to the same store file
+  for (size_t i = 0; i != _max_presets; ++i)
+    PersistManager::getInstance().flush(_preset_id(i).c_str());
+
+  String path(mkFileName(NULL, "/", ".prs"));
+  String legacy(mkFileName());
+  if (!LittleFS.exists(legacy)) return _store->begin(path.c_str());
+
+  // import presets from legacy json file {"last_preset":n, "presets":[{"label":"...", "cfg":{}}]}
+  // legacy file is removed only when all of it's presets are written, so an interrupted or failed import is started over
+  JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::units));
+  if (embuifs::deserializeFileAtomic(doc, legacy.c_str())) return _store->begin(path.c_str());
+  LittleFS.remove(path);
+  if (!_store->begin(path.c_str())) return false;
+  LOGI(P_Unit, printf, "%s: importing presets from %s\n", label, legacy.c_str());
+  bool ok{true};
+  size_t idx{0};
+  for (JsonVariantConst v : doc[T_presets].as<JsonArrayConst>()){
+    if (idx == _store->count()) break;
+    if (v[T_cfg].is<JsonObjectConst>() && !_store->save(idx, v[P_label].as<const char*>(), v[T_cfg])){
+      ok = false;
+      break;
+    }
+    ++idx;
+  }
+  // restore last used preset mark
+  int32_t last = doc[T_last_preset] | 0;
+  if (ok && _store->exist(last) && _store->last() != last)
+    ok = _store->save(last, _store->label(last), doc[T_presets][last][T_cfg]);
+
+  if (!ok){
+    LOGE(P_Unit, printf, "%s: presets import failed, will retry on next start\n", label);
+    // drop partially imported store
+    LittleFS.remove(path);
+    return _store->begin(path.c_str());
+  }
+  LittleFS.remove(legacy);
+  return true;
+}
+
 void EmbUIUnit_Presets::switchPreset(int32_t idx, bool keepcurrent){
   // check I do not need to load preset's config
   if (keepcurrent){
-    if (idx >= 0 && idx < EMBUI_UNIT_DEFAULT_NUM_OF_PRESETS)
+    if (idx >= 0 && static_cast<size_t>(idx) < _max_presets)
       _presetnum = idx;
     return;
   }
 
-  JsonDocument doc;
-  embuifs::deserializeFile(doc, mkFileName().c_str());
+  _open_store();
 
   // restore last used preset if specified one is wrong or < 0
-  if (idx < 0 || idx >= EMBUI_UNIT_DEFAULT_NUM_OF_PRESETS)
-    _presetnum = doc[T_last_preset];
+  if (idx < 0 || static_cast<size_t>(idx) >= _max_presets)
+    _presetnum = _store->last();
   else
     _presetnum = idx;
 
-
   LOGD(P_Unit, printf, "%s switch preset:%d\n", label, _presetnum);
-  JsonArray presets = doc[T_presets].as<JsonArray>();
+  // pending write of this preset must land first, otherwise stale config would be loaded
+  PersistManager::getInstance().flush(_preset_id(_presetnum).c_str());
   // load name
-  JsonVariant v = presets[_presetnum][P_label];
-  if (v.is<const char*>())
-    _presetname = v.as<const char*>();
+  const char* l = _store->label(_presetnum);
+  if (l)
+    _presetname = l;
   else {
     _presetname = T_preset;
-    _presetname += idx;
+    _presetname += _presetnum;
   }
-  // load unit's config
-  load_cfg(presets[_presetnum][T_cfg]);
+  // load unit's config, only this preset's record is read
+  JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::units));
+  _store->load(_presetnum, doc);
+  load_cfg(doc);
   start();
 }
 
 void EmbUIUnit_Presets::save(){
-  JsonDocument doc;
-  embuifs::deserializeFile(doc, mkFileName().c_str());
-
-  JsonVariant arr = doc[T_presets].isNull() ? doc[T_presets].to<JsonArray>() : doc[T_presets];
-  // if array does not have proper num of objects, prefill it with empty ones
-  if (arr.size() < EMBUI_UNIT_DEFAULT_NUM_OF_PRESETS){
-    size_t s = arr.size();
-    JsonObject empty;
-    while (s++ != EMBUI_UNIT_DEFAULT_NUM_OF_PRESETS){
-      arr.add(empty);
-    } 
-  }
+  if (!_open_store()) return;
 
-  // generate config to current preset cell
-  JsonObject o = arr[_presetnum].to<JsonObject>();
-  o[P_label] = _presetname;
-  getConfig(o[T_cfg].to<JsonObject>());    // place config under {"cfg":{}} object
+  // snapshot current config, unit might be destroyed before the write
+  auto cfg = std::make_shared<JsonDocument>(embui_mem::allocator(embui_mem::subsys_t::units));
+  getConfig(cfg->to<JsonObject>());
 
-  doc[T_last_preset] = _presetnum;
+  // only current preset's record is rewritten
+  PersistManager::getInstance().dirty(_preset_id(_presetnum).c_str(), [store = _store, idx = _presetnum, lbl = std::string(_presetname.c_str()), cfg](){
+    return store->save(idx, lbl.c_str(), *cfg);
+  });
+  FrameCache::getInstance().invalidate();
+}
 
-  LOGD(P_Unit, printf, "%s: writing cfg to file\n", label);
-  embuifs::serialize2file(doc, mkFileName().c_str());
+std::string EmbUIUnit_Presets::_preset_id(int32_t idx){
+  std::string id(mkFileName(NULL, "/", ".prs").c_str());
+  id += (char)0x23;   // '#' char
+  id += std::to_string(idx);
+  return id;
 }
 
 void EmbUIUnit_Presets::mkEmbUIpage(Interface *interf, JsonVariantConst data, const char* action){
@@ -225,21 +292,19 @@ void EmbUIUnit_Presets::mkEmbUI_preset(Interface *interf){
 }
 
 size_t EmbUIUnit_Presets::mkPresetsIndex(JsonArray arr){
-  JsonDocument doc;
-  embuifs::deserializeFile(doc, mkFileName().c_str());
+  // index is kept in RAM, no file reads here
+  _open_store();
 
-  JsonArray presets = doc[T_presets];
-
-  size_t idx{0};
   String p; 
-  for(JsonVariant v : presets) {
+  for (size_t idx = 0; idx != _store->count(); ++idx){
     JsonObject d = arr.add<JsonObject>();
 
-    // check if preset config and label exists indeed
-    if (v[P_label].is<JsonVariant>()){
+    // check if preset label exists indeed
+    const char* l = _store->label(idx);
+    if (l){
       p = idx;
       p += " - ";
-      p += v[P_label].as<const char*>();
+      p += l;
     } else {
       // generate "preset1" string
       p = T_preset;
@@ -248,12 +313,11 @@ size_t EmbUIUnit_Presets::mkPresetsIndex(JsonArray arr){
 
     d[P_label] = p;
     d[P_value] = idx;
-    ++idx;
   }
 
-  LOGD(P_Unit, printf, "make index of %u presets\n", idx);
+  LOGD(P_Unit, printf, "make index of %u presets\n", _store->count());
 
-  return idx;
+  return _store->count();
 }
 
 
@@ -328,17 +392,14 @@ void EmbUI_Unit_Manager::setConfig(std::string_view label, JsonVariantConst cfg)
 void EmbUI_Unit_Manager::getUnitsStatuses(Interface *interf) const {
   if (!units.size()) return;
 
+  // long lists are published in chunks to all feeders, so that building it does not stall the scheduler
+  if (units.size() > EMBUI_UNITS_STATUS_CHUNK)
+    return streamUnitsStatuses(&embui.feeders);
+
   interf->json_frame_value();
   // generate values with each unit's state started/not started
-  // unit's state id format "set_embuium_{namespace}_unit_{unit_lbl}_state"
   for ( auto i = units.cbegin(); i != units.cend(); ++i){
-    std::string s(T_set_embuium_);
-    s.append(ns);
-    s.append(1, (char)0x5f);  // '_'
-    s.append(P_unit);
-    s.append(1, (char)0x5f);  // '_'
-    s.append((*i)->getLabel());
-    s.append(T__state);
+    std::string s(_state_id((*i)->getLabel()));
     LOGD(T_UnitMgr, printf, "Unit enabled:%s\n", s.c_str());
     interf->value( s, true);
   }
@@ -346,6 +407,36 @@ void EmbUI_Unit_Manager::getUnitsStatuses(Interface *interf) const {
   //interf->json_frame_flush();
 }
 
+void EmbUI_Unit_Manager::streamUnitsStatuses(FrameSend *feeder, size_t chunk) const {
+  if (!units.size() || !chunk) return;
+
+  // ids are collected upfront, units list might change while generator is running
+  std::vector<std::string> ids;
+  ids.reserve(units.size());
+  for (const auto &u : units)
+    ids.emplace_back(_state_id(u->getLabel()));
+
+  FrameGenerator::getInstance().run(feeder, [ids = std::move(ids), chunk](Interface *interf, size_t step){
+    if (!step) interf->json_frame_value();
+    size_t end = std::min(ids.size(), (step + 1) * chunk);
+    for (size_t i = step * chunk; i < end; ++i)
+      interf->value(ids[i], true);
+    return end != ids.size();
+  });
+}
+
+std::string EmbUI_Unit_Manager::_state_id(const char* label) const {
+  // unit's state id format "set_embuium_{namespace}_unit_{unit_lbl}_state"
+  std::string s(T_set_embuium_);
+  s.append(ns);
+  s.append(1, (char)0x5f);  // '_'
+  s.append(P_unit);
+  s.append(1, (char)0x5f);  // '_'
+  s.append(label);
+  s.append(T__state);
+  return s;
+}
+
 EmbUIUnit* EmbUI_Unit_Manager::getUnitPtr(std::string_view label){
   if (!units.size()) return nullptr;
   auto i = std::find_if(units.begin(), units.end(), EmbUIUnit_MatchLabel<EmbUIUnit_pt>(label));
@@ -419,7 +510,7 @@ void EmbUI_Unit_Manager::_unit_setter(Interface *interf, JsonVariantConst data,
     sv.remove_suffix(std::string_view(T_presetsw).length());  // this is constexpr
     switchPreset(sv, data);
     // send to webUI refreshed unit's config
-    JsonDocument doc;
+    JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::units));
     getConfig(sv, doc.to<JsonObject>());
     interf->json_frame_value(doc);
     interf->json_frame_flush();
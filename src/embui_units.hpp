@@ -24,8 +24,10 @@
 */
 
 #pragma once
+#include <memory>
 #include "ui.h"
 #include "embui_constants.h"
+#include "embui_presets.hpp"
 
 /*
 
@@ -89,21 +91,6 @@ static constexpr const char* T_presets                = "presets";
 static constexpr const char* T_presetsw               = "_presetsw";
 static constexpr const char* T__state                 = "_state";
 
-// literals hashing
-// https://learnmoderncpp.com/2020/06/01/strings-as-switch-case-labels/
-
-inline constexpr auto hash_djb2a(const std::string_view sv) {
-    unsigned long hash{ 5381 };
-    for (unsigned char c : sv) {
-      hash = ((hash << 5) + hash) ^ c;
-    }
-    return hash;
-}
-
-inline constexpr auto operator"" _sh(const char *str, size_t len) {
-    return hash_djb2a(std::string_view{ str, len });
-}
-
 
 /**
  * @brief an abstract class to implement dynamically loaded components or units
@@ -151,7 +138,8 @@ public:
 
   /**
    * @brief save current unit's configuration to file
-   * 
+   * configuration is snapshotted and written by PersistManager after a short delay,
+   * subsequent changes within the delay are coalesced into a single write
    */
   virtual void save();
 
@@ -262,10 +250,14 @@ protected:
    * @note for shared config filename would be '/{path}/{id}.json', if id is not NULL, and '/{path}/{label}.json' otherwise
    * for Units with dedicated config filename would be '/{path}/{id}_{label}.json'
    * @param prefix prepended to the file's name
+   * @param ext file's extension
    * @return String 
    */
-  String mkFileName(const char* id = NULL, const char* path = "/");
+  String mkFileName(const char* id = NULL, const char* path = "/", const char* ext = ".json");
 
+private:
+  // PersistManager's id for unit's config, units sharing a file are kept apart with "{file}#{label}"
+  std::string _cfg_id();
 };
 
 
@@ -283,11 +275,22 @@ class EmbUIUnit_Presets : public EmbUIUnit {
   const size_t _max_presets; 
   int32_t _presetnum{0};
   String _presetname;
+  // presets storage with in-memory index, shared with pending writes of persistence manager
+  std::shared_ptr<PresetStore> _store;
 
   void _load_preset(int idx);
 
+  /**
+   * @brief open presets store on first access
+   * presets from legacy '{ns}_{label}.json' file are imported to a new store
+   */
+  bool _open_store();
+
+  // persistence manager's id for preset's record
+  std::string _preset_id(int32_t idx);
+
 public:
-  EmbUIUnit_Presets(const char* label, const char* name_space = NULL, size_t max_presets = EMBUI_UNIT_DEFAULT_NUM_OF_PRESETS) : EmbUIUnit(label, name_space, false), _max_presets(max_presets) {}
+  EmbUIUnit_Presets(const char* label, const char* name_space = NULL, size_t max_presets = EMBUI_UNIT_DEFAULT_NUM_OF_PRESETS) : EmbUIUnit(label, name_space, false), _max_presets(max_presets), _store(std::make_shared<PresetStore>(max_presets)) {}
 
   /**
    * @brief load unit's config from persistent storage and calls start()
@@ -295,7 +298,7 @@ public:
    */
   void load() override final { switchPreset(-1); };
 
-  // save current Unit's presest to file
+  // save current Unit's preset to store, only preset's record is written by PersistManager
   void save() override final;
 
   /**
@@ -419,11 +422,22 @@ public:
   /**
    * @brief generate Interface values object representing boolen states
    * of currently active/inactive units
+   * if there are more than EMBUI_UNITS_STATUS_CHUNK units, states are published with streamUnitsStatuses() to all feeders instead
    * 
    * @param interf 
    */
   virtual void getUnitsStatuses(Interface *interf) const;
 
+  /**
+   * @brief publish units states incrementally
+   * same values as getUnitsStatuses() are sent in chunks on consecutive scheduler ticks via FrameGenerator,
+   * so that a manager with lots of units does not stall the scheduler
+   * 
+   * @param feeder sender to publish to, i.e. &embui.feeders
+   * @param chunk number of units per chunk
+   */
+  void streamUnitsStatuses(FrameSend *feeder, size_t chunk = EMBUI_UNITS_STATUS_CHUNK) const;
+
   /**
    * @brief Get state of the specific Unit active/inactive
    * 
@@ -479,6 +493,9 @@ protected:
 
 
 private:
+  // make id of unit's state value
+  std::string _state_id(const char* label) const;
+
   /**
    * @brief a callback method for EmbUI to generate units UI pages
    * will render a default unit's setup/state page based on serialized configuration data 
@@ -0,0 +1,111 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include <cmath>
+#include <string>
+#include "embui_values.hpp"
+#include "ui.h"
+#include "embuifs.hpp"
+
+static constexpr const char* K_value = "v";
+static constexpr const char* K_html = "h";
+static constexpr const char* K_gen = "g";
+static constexpr const char* K_threshold = "t";
+
+bool ValueCache::_equal(JsonVariantConst entry, JsonVariantConst value) const {
+    JsonVariantConst cached = entry[K_value];
+    if (entry[K_threshold].is<float>() && cached.is<float>() && value.is<float>())
+        return std::fabs(cached.as<float>() - value.as<float>()) < entry[K_threshold].as<float>();
+    return cached == value;
+}
+
+bool ValueCache::update(const char* id, JsonVariantConst value, bool html, bool delta){
+    if (!id) return true;
+    std::lock_guard<std::mutex> lock(_mtx);
+
+    // ids come from short-lived frames, key must be copied
+    std::string key(id);
+    JsonObject entry = _cache[key];
+    if (entry.isNull())
+        entry = _cache[key].to<JsonObject>();
+    else if (delta && entry[K_gen] == _gen && _equal(entry, value))
+        return false;
+
+    embuifs::deepcopy(entry[K_value].to<JsonVariant>(), value);
+    entry[K_gen] = _gen;
+    if (html)
+        entry[K_html] = true;
+    else
+        entry.remove(K_html);
+    return true;
+}
+
+void ValueCache::update(JsonVariantConst data){
+    if (data.is<JsonArrayConst>()){
+        for (JsonVariantConst item : data.as<JsonArrayConst>()){
+            // labeled objects
+            if (item[P_id].is<const char*>() && !item[P_value].isNull())
+                update(item[P_id].as<const char*>(), item[P_value], item[P_html].as<bool>());
+            else
+                update(item);
+        }
+        return;
+    }
+
+    for (JsonPairConst kv : data.as<JsonObjectConst>())
+        update(kv.key().c_str(), kv.value(), false);
+}
+
+void ValueCache::threshold(const char* id, float threshold){
+    std::lock_guard<std::mutex> lock(_mtx);
+    std::string key(id);
+    JsonObject entry = _cache[key];
+    if (entry.isNull())
+        entry = _cache[key].to<JsonObject>();
+    if (threshold)
+        entry[K_threshold] = threshold;
+    else
+        entry.remove(K_threshold);
+}
+
+void ValueCache::invalidate(){
+    std::lock_guard<std::mutex> lock(_mtx);
+    ++_gen;
+}
+
+void ValueCache::remove(const char* id){
+    std::lock_guard<std::mutex> lock(_mtx);
+    _cache.remove(id);
+}
+
+void ValueCache::clear(){
+    std::lock_guard<std::mutex> lock(_mtx);
+    _cache.clear();
+}
+
+void ValueCache::snapshot(Interface *interf){
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (!_cache.size()) return;
+    interf->json_frame_value();
+    for (JsonPairConst kv : _cache.as<JsonObjectConst>()){
+        JsonVariantConst v = kv.value()[K_value];
+        // entries with only a threshold set have not been published yet
+        if (v.isNull()) continue;
+        // objects are added directly, bypassing the cache
+        JsonObject o(interf->json_object_create());
+        if (kv.value()[K_html]){
+            o[P_id] = kv.key();
+            o[P_value] = v;
+            o[P_html] = true;
+        } else
+            o[kv.key()] = v;
+    }
+    interf->json_frame_flush();
+}
@@ -0,0 +1,111 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <mutex>
+#include <ArduinoJson.h>
+#include "embui_mem.hpp"
+
+class Interface;
+
+/**
+ * @brief last-value cache for UI values
+ * keeps the latest value for every key published via Interface's value frames.
+ * It is used to publish only changed values to WebUI and to provide newly connected clients
+ * with a snapshot of current values
+ *
+ *  cache structure
+ *  {
+ *    $id:{
+ *      "v": value,       // last published value
+ *      "h": true,        // (optional) value is an html placeholder, i.e. {"id":$id, "value":$v, "html":true}
+ *      "g": 1,           // generation when value was published
+ *      "t": 0.1          // (optional) change threshold for numeric values
+ *    }
+ *  }
+ */
+class ValueCache {
+    JsonDocument _cache{embui_mem::allocator(embui_mem::subsys_t::misc)};
+    // publish generation, incremented when WebUI pages are (re)created and values must be published again
+    uint32_t _gen{1};
+    std::mutex _mtx;
+
+    ValueCache() = default;
+
+    // check if cached value is equal to the new one, considering threshold if set
+    bool _equal(JsonVariantConst entry, JsonVariantConst value) const;
+
+public:
+    // this is a singleton
+    ValueCache(ValueCache const&) = delete;
+    void operator=(ValueCache const&) = delete;
+
+    /**
+     * obtain a reference to singleton instance
+     */
+    static ValueCache& getInstance(){
+        static ValueCache inst;
+        return inst;
+    }
+
+    /**
+     * @brief update cached value
+     *
+     * @param id value's key
+     * @param value value
+     * @param html value is an html placeholder
+     * @param delta if true, value is not updated when it's unchanged since the last publish
+     * @return true if value should be published
+     * @return false if delta was requested and value is unchanged
+     */
+    bool update(const char* id, JsonVariantConst value, bool html, bool delta = false);
+
+    /**
+     * @brief update cached values from a value frame's object
+     * accepts same data as Interface::value(JsonVariantConst), i.e. a dict of key:value pairs,
+     * or an array of such dicts or labeled objects {"id":"someid", "value":"someval", "html": true}
+     *
+     * @param data
+     */
+    void update(JsonVariantConst data);
+
+    /**
+     * @brief set change threshold for a numeric value
+     * value change less than threshold is not published in delta frames, useful for noisy sensors
+     *
+     * @param id value's key
+     * @param threshold absolute change threshold, 0 - publish any change
+     */
+    void threshold(const char* id, float threshold);
+
+    /**
+     * @brief mark all values as unpublished
+     * should be called when WebUI page is re-created for clients and values has to be published again
+     */
+    void invalidate();
+
+    /**
+     * @brief remove value from cache
+     */
+    void remove(const char* id);
+
+    /**
+     * @brief purge cache
+     */
+    void clear();
+
+    /**
+     * @brief send all cached values in a single value frame
+     *
+     * @param interf
+     */
+    void snapshot(Interface *interf);
+};
@@ -0,0 +1,137 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include "embui_workers.hpp"
+#include "EmbUI.h"
+#include "esp_timer.h"
+#include "embui_log.h"
+
+AsyncJob::AsyncJob(const char* action, JsonVariantConst data, const embui_async_cb_t& work, const embui_done_cb_t& done) :
+    _action(action ? action : ""), _work(work), _done(done) {
+    _data.set(data);
+}
+
+WorkerPool::WorkerPool(){
+    _tJobs.set(EMBUI_WORKER_POLL_MS * TASK_MILLISECOND, TASK_FOREVER, [this](){ _process(); });
+}
+
+bool WorkerPool::begin(size_t workers, uint32_t stack, BaseType_t core, UBaseType_t priority){
+    if (_q) return true;
+    if (!workers) return false;
+    _q = xQueueCreate(EMBUI_WORKER_QUEUE, sizeof(AsyncJob*));
+    if (!_q) return false;
+
+    _workers.reserve(workers);
+    for (size_t i = 0; i != workers; ++i){
+        TaskHandle_t h{nullptr};
+        if (xTaskCreatePinnedToCore(_worker, "embui_wrk", stack, this, priority, &h, core) != pdPASS){
+            LOGW(P_EmbUI, printf, "can't start worker task %u\n", i);
+            break;
+        }
+        _workers.push_back(h);
+    }
+    if (_workers.empty()){
+        vQueueDelete(_q);
+        _q = nullptr;
+        return false;
+    }
+    _util_ts = millis();
+    LOGD(P_EmbUI, printf, "started %u workers, stack:%u, core:%d\n", _workers.size(), stack, core);
+    return true;
+}
+
+void WorkerPool::_worker(void* arg){
+    auto pool = static_cast<WorkerPool*>(arg);
+    AsyncJob *job;
+    for (;;){
+        if (xQueueReceive(pool->_q, &job, portMAX_DELAY) != pdTRUE) continue;
+        ++pool->_running;
+        job->_state = AsyncJob::state_t::running;
+        int64_t t = esp_timer_get_time();
+        if (job->_work) job->_work(*job);
+        pool->_busy_ms += static_cast<uint32_t>((esp_timer_get_time() - t) / 1000);
+        --pool->_running;
+        // job is handed back to EmbUI's task, worker must not touch it after this point
+        job->_state = AsyncJob::state_t::done;
+    }
+}
+
+bool WorkerPool::submit(Interface *interf, const char* action, JsonVariantConst data, const embui_async_cb_t& work, const embui_done_cb_t& done){
+    AsyncJob *job = new AsyncJob(action, data, work, done);
+    if (!begin() || xQueueSend(_q, &job, 0) != pdTRUE){
+        LOGW(P_EmbUI, printf, "worker queue full, action '%s' rejected\n", job->action());
+        ++_rejected;
+        job->_state = AsyncJob::state_t::rejected;
+        if (job->_done) job->_done(interf, *job);
+        delete job;
+        return false;
+    }
+
+    _jobs.push_back(job);
+    if (!_task_added){
+        ts.addTask(_tJobs);
+        _task_added = true;
+    }
+    _tJobs.enableIfNot();
+    return true;
+}
+
+void WorkerPool::_process(){
+    // deferred results are sent to all feeders, the Interface that posted the action does not outlive the handler
+    Interface interf(&embui.feeders);
+    bool progress{false};
+    for (auto i = _jobs.begin(); i != _jobs.end(); ){
+        AsyncJob *job = *i;
+        // read state before progress, so that final progress value reported by work function is not missed
+        bool done = job->_state == AsyncJob::state_t::done;
+        uint8_t p = job->_progress.load(std::memory_order_relaxed);
+        if (p != job->_progress_sent){
+            if (!progress){
+                interf.json_frame_value();
+                progress = true;
+            }
+            interf.value(job->action(), p);
+            job->_progress_sent = p;
+        }
+        if (!done){
+            ++i;
+            continue;
+        }
+        if (progress){
+            // progress must precede completion frames
+            interf.json_frame_flush();
+            progress = false;
+        }
+        if (job->_done){
+            job->_done(&interf, *job);
+            interf.json_frame_flush();
+        }
+        delete job;
+        i = _jobs.erase(i);
+        ++_completed;
+    }
+    if (progress) interf.json_frame_flush();
+    if (_jobs.empty()) _tJobs.disable();
+}
+
+WorkerPool::stat_t WorkerPool::stats() const {
+    return { _workers.size(), _q ? static_cast<size_t>(uxQueueMessagesWaiting(_q)) : 0, _running, _completed, _rejected, _busy_ms };
+}
+
+uint8_t WorkerPool::utilization(){
+    if (_workers.empty()) return 0;
+    uint32_t now = millis();
+    uint32_t busy = _busy_ms;
+    uint32_t span = (now - _util_ts) * _workers.size();
+    uint8_t u = span ? std::min<uint32_t>(100, (busy - _util_busy) * 100 / span) : 0;
+    _util_ts = now;
+    _util_busy = busy;
+    return u;
+}
@@ -0,0 +1,177 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <string>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <ArduinoJson.h>
+#include "embui_mem.hpp"
+#include "embui_defines.h"
+#include "ts.h"
+
+class Interface;
+class AsyncJob;
+
+// action handler's work function, runs on a worker task
+using embui_async_cb_t = std::function< void (AsyncJob& job)>;
+// action handler's completion callback, runs on EmbUI's task
+using embui_done_cb_t = std::function< void (Interface *interf, AsyncJob& job)>;
+
+/**
+ * @brief deferred action job
+ * keeps a copy of action's data, work function fills in the result that is passed to completion callback
+ */
+class AsyncJob {
+    friend class WorkerPool;
+
+public:
+    enum class state_t : uint8_t {
+        queued = 0,
+        running,
+        done,
+        rejected        // job queue was full, work function was not executed
+    };
+
+private:
+    std::string _action;
+    JsonDocument _data{embui_mem::allocator(embui_mem::subsys_t::ingress)};
+    embui_async_cb_t _work;
+    embui_done_cb_t _done;
+    std::atomic<state_t> _state{state_t::queued};
+    std::atomic<uint8_t> _progress{0};
+    // last progress value sent to UI
+    uint8_t _progress_sent{0};
+
+public:
+    AsyncJob(const char* action, JsonVariantConst data, const embui_async_cb_t& work, const embui_done_cb_t& done);
+
+    // action name
+    const char* action() const { return _action.c_str(); }
+
+    // action's data
+    JsonVariantConst data() const { return _data; }
+
+    /**
+     * @brief job's result, work function could fill it in and completion callback get it
+     * it must not be accessed by completion callback until work is done
+     */
+    JsonDocument result{embui_mem::allocator(embui_mem::subsys_t::misc)};
+
+    /**
+     * @brief report job's progress (could be called from work function)
+     * progress is published to UI as a value with action's name as a key, i.e. for a progressbar element with same id
+     *
+     * @param percent 0-100
+     */
+    void progress(uint8_t percent){ _progress.store(percent, std::memory_order_relaxed); }
+
+    state_t state() const { return _state; }
+};
+
+/**
+ * @brief a pool of FreeRTOS tasks to run long action handlers
+ * Handlers that scan files, talk to slow peripherals, etc... would block EmbUI's task and all the UI traffic
+ * if executed synchronously. Such handlers could be registered with ActionHandler::add_async(), then action's work
+ * function runs on a worker task, while job's progress and completion callback are processed on EmbUI's task,
+ * so that completion callback could use Interface as usual.
+ * Pool is started with default settings on first job if begin() was not called
+ */
+class WorkerPool {
+public:
+    struct stat_t {
+        // number of worker tasks
+        size_t workers;
+        // jobs waiting for a worker
+        size_t queued;
+        // jobs being executed
+        size_t running;
+        // jobs completed
+        uint32_t completed;
+        // jobs rejected due to queue overflow
+        uint32_t rejected;
+        // total time workers were busy, ms
+        uint32_t busy_ms;
+    };
+
+private:
+    QueueHandle_t _q{nullptr};
+    std::vector<TaskHandle_t> _workers;
+    // jobs not yet completed, accessed from EmbUI's task only
+    std::list<AsyncJob*> _jobs;
+    Task _tJobs;
+    bool _task_added{false};
+    std::atomic<size_t> _running{0};
+    std::atomic<uint32_t> _busy_ms{0};
+    uint32_t _completed{0};
+    uint32_t _rejected{0};
+    // utilization measurement window
+    uint32_t _util_ts{0};
+    uint32_t _util_busy{0};
+
+    WorkerPool();
+
+    // worker task
+    static void _worker(void* arg);
+
+    // publish progress and run completion callbacks for finished jobs, runs on EmbUI's task
+    void _process();
+
+public:
+    // this is a singleton
+    WorkerPool(WorkerPool const&) = delete;
+    void operator=(WorkerPool const&) = delete;
+
+    /**
+     * obtain a reference to singleton instance
+     */
+    static WorkerPool& getInstance(){
+        static WorkerPool inst;
+        return inst;
+    }
+
+    /**
+     * @brief start worker tasks
+     * has no effect if pool is already started
+     *
+     * @param workers number of worker tasks
+     * @param stack worker's stack size, bytes
+     * @param core core to pin workers to, tskNO_AFFINITY - any core
+     * @param priority worker's task priority
+     * @return true on success
+     */
+    bool begin(size_t workers = EMBUI_WORKERS, uint32_t stack = EMBUI_WORKER_STACK, BaseType_t core = EMBUI_WORKER_CORE, UBaseType_t priority = EMBUI_WORKER_PRIORITY);
+
+    /**
+     * @brief submit a job to workers, should be called from EmbUI's task
+     * if job queue is full, completion callback is called right away with job in 'rejected' state
+     *
+     * @param interf Interface to pass to completion callback for a rejected job
+     * @param action action name
+     * @param data action's data, it is copied
+     * @param work work function
+     * @param done completion callback
+     * @return true if job was queued
+     */
+    bool submit(Interface *interf, const char* action, JsonVariantConst data, const embui_async_cb_t& work, const embui_done_cb_t& done);
+
+    stat_t stats() const;
+
+    /**
+     * @brief workers utilization since previous call, percent
+     */
+    uint8_t utilization();
+};
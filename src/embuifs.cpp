@@ -8,13 +8,78 @@
     it under the terms of MIT License https://opensource.org/license/mit/
 */
 
+#include <vector>
+#include "esp_rom_crc.h"
 #include "embuifs.hpp"
+#include "embui_mem.hpp"
+#include "embui_fswriter.hpp"
 #include "embui_constants.h"
 #include "embui_log.h"
 
 static constexpr const char* T_load_file = "Lod file: %s\n";
 static constexpr const char* T_cant_open_file = "Can't open file: %s\n";
 static constexpr const char* T_deserialize_err = "failed to load json file: %s, deserialize error: %s\n";
+static constexpr const char* T_tmp_suffix = ".tmp";
+
+// checksum trailer is '\n' followed by 8 hex digits of CRC32 and '\n'
+#define EMBUIFS_CRC_TRAILER_LEN     10
+
+/**
+ * @brief ArduinoJson writer that calculates CRC32 of the data and passes it to downstream Print (if any)
+ */
+class CRCWriter {
+    Print *_out;
+public:
+    uint32_t crc{0};
+    explicit CRCWriter(Print *out = nullptr) : _out(out) {}
+    size_t write(uint8_t c){ crc = esp_rom_crc32_le(crc, &c, 1); return _out ? _out->write(c) : 1; }
+    size_t write(const uint8_t *s, size_t n){ crc = esp_rom_crc32_le(crc, s, n); return _out ? _out->write(s, n) : n; }
+};
+
+/**
+ * @brief read file's checksum trailer
+ * 
+ * @param f file
+ * @param crc checksum from the trailer
+ * @return true if file has a checksum trailer
+ */
+static bool read_trailer(File &f, uint32_t &crc){
+    size_t size = f.size();
+    if (size <= EMBUIFS_CRC_TRAILER_LEN) return false;
+
+    char trailer[EMBUIFS_CRC_TRAILER_LEN]{};
+    f.seek(size - EMBUIFS_CRC_TRAILER_LEN);
+    if (f.read(reinterpret_cast<uint8_t*>(trailer), EMBUIFS_CRC_TRAILER_LEN) != EMBUIFS_CRC_TRAILER_LEN || trailer[0] != '\n' || trailer[EMBUIFS_CRC_TRAILER_LEN-1] != '\n')
+        return false;
+    trailer[EMBUIFS_CRC_TRAILER_LEN-1] = 0;
+    char *end;
+    crc = std::strtoul(trailer + 1, &end, 16);
+    return end == trailer + EMBUIFS_CRC_TRAILER_LEN - 1;
+}
+
+/**
+ * @brief verify file's checksum trailer
+ * 
+ * @param f file to check
+ * @param crc calculated checksum of the content
+ * @return int 1 - checksum is valid, 0 - file has no checksum trailer, -1 - checksum mismatch
+ */
+static int crc_check(File &f, uint32_t &crc, size_t buffsize){
+    uint32_t expected;
+    if (!read_trailer(f, expected)) return 0;
+    size_t size = f.size();
+
+    f.seek(0);
+    std::vector<uint8_t> buff(buffsize);
+    crc = 0;
+    for (size_t left = size - EMBUIFS_CRC_TRAILER_LEN; left; ){
+        size_t n = f.read(buff.data(), std::min(left, buffsize));
+        if (!n) return -1;
+        crc = esp_rom_crc32_le(crc, buff.data(), n);
+        left -= n;
+    }
+    return crc == expected ? 1 : -1;
+}
 
 namespace embuifs {
 
@@ -29,6 +94,187 @@ namespace embuifs {
         return len;
     }
 
+    size_t serialize2fileAtomic(JsonVariantConst v, const char* filepath, uint32_t* crc, bool msgpack, size_t buffsize){
+        // dry run to get content's checksum, do not wear flash if nothing has changed
+        CRCWriter probe;
+        size_t len{0};
+        if (msgpack){
+            len = probe.write(msgpack_hdr, sizeof(msgpack_hdr));
+            len += serializeMsgPack(v, probe);
+        } else
+            len = serializeJson(v, probe);
+        if (crc && *crc == probe.crc){
+            LOGD(P_EmbUI, printf, "%s is unchanged, skip writing\n", filepath);
+            return 0;
+        }
+
+        String tmp(filepath);
+        tmp += T_tmp_suffix;
+        File hndlr = LittleFS.open(tmp, "w");
+        if (!hndlr){
+            LOGE(P_EmbUI, printf, T_cant_open_file, tmp.c_str());
+            return 0;
+        }
+
+        WriteBufferingStream bufferedFile(hndlr, buffsize);
+        if (msgpack){
+            bufferedFile.write(msgpack_hdr, sizeof(msgpack_hdr));
+            serializeMsgPack(v, bufferedFile);
+        } else
+            serializeJson(v, bufferedFile);
+        char trailer[EMBUIFS_CRC_TRAILER_LEN + 1];
+        std::snprintf(trailer, sizeof(trailer), "\n%08lx\n", static_cast<unsigned long>(probe.crc));
+        bufferedFile.write(reinterpret_cast<const uint8_t*>(trailer), EMBUIFS_CRC_TRAILER_LEN);
+        bufferedFile.flush();
+        size_t written = hndlr.size();
+        hndlr.close();
+
+        // incomplete write, i.e. FS is full. Destination file is left untouched
+        if (written != len + EMBUIFS_CRC_TRAILER_LEN || !LittleFS.rename(tmp, filepath)){
+            LOGE(P_EmbUI, printf, "failed to write file: %s\n", filepath);
+            LittleFS.remove(tmp);
+            return 0;
+        }
+
+        if (crc) *crc = probe.crc;
+        return written;
+    }
+
+    size_t serialize2fileAsync(JsonVariantConst v, const char* filepath, uint32_t* crc, bool msgpack){
+#if EMBUI_FS_ASYNC
+        if (!filepath || !*filepath) return 0;
+        size_t hdr = msgpack ? sizeof(msgpack_hdr) : 0;
+        size_t len = msgpack ? measureMsgPack(v) : measureJson(v);
+        // room for json's null terminator and checksum trailer
+        std::vector<uint8_t> buff(hdr + len + EMBUIFS_CRC_TRAILER_LEN + 1);
+        if (msgpack){
+            memcpy(buff.data(), msgpack_hdr, hdr);
+            serializeMsgPack(v, buff.data() + hdr, len);
+        } else
+            serializeJson(v, reinterpret_cast<char*>(buff.data()), len + 1);
+
+        uint32_t c = esp_rom_crc32_le(0, buff.data(), hdr + len);
+        if (crc && *crc == c){
+            LOGD(P_EmbUI, printf, "%s is unchanged, skip writing\n", filepath);
+            return 0;
+        }
+        std::snprintf(reinterpret_cast<char*>(buff.data() + hdr + len), EMBUIFS_CRC_TRAILER_LEN + 1, "\n%08lx\n", static_cast<unsigned long>(c));
+        buff.resize(hdr + len + EMBUIFS_CRC_TRAILER_LEN);
+
+        size_t n = buff.size();
+        if (FSWriter::getInstance().write(filepath, std::move(buff), [crc, c](size_t written){ if (crc && written) *crc = c; }))
+            return n;
+        LOGW(P_EmbUI, printf, "FS writer is busy, writing %s synchronously\n", filepath);
+        // an older write of the same file must not land after this one
+        FSWriter::getInstance().sync(filepath);
+#endif
+        return serialize2fileAtomic(v, filepath, crc, msgpack);
+    }
+
+    /**
+     * @brief open file written with serialize2fileAtomic() for reading
+     * waits for pending background write, recovers interrupted write and verifies checksum
+     * 
+     * @param crc checksum of the content, 0 if file has no checksum
+     * @return File positioned at the start of content, closed file on failure
+     */
+    static File open_atomic(const char* filepath, uint32_t& crc, size_t buffsize){
+#if EMBUI_FS_ASYNC
+        // file might be in the middle of background write
+        FSWriter::getInstance().sync(filepath);
+#endif
+        crc = 0;
+
+        // a complete temp file means that write was interrupted before rename, it is the newest copy
+        String tmp(filepath);
+        tmp += T_tmp_suffix;
+        if (LittleFS.exists(tmp)){
+            File f = LittleFS.open(tmp);
+            uint32_t c;
+            bool complete = f && crc_check(f, c, buffsize) == 1;
+            f.close();
+            if (complete){
+                LOGW(P_EmbUI, printf, "recovering interrupted write of %s\n", filepath);
+                LittleFS.rename(tmp, filepath);
+            } else
+                LittleFS.remove(tmp);
+        }
+
+        File jfile = LittleFS.open(filepath);
+        if (!jfile){
+            LOGD(P_EmbUI, printf, T_cant_open_file, filepath);
+            return jfile;
+        }
+
+        if (crc_check(jfile, crc, buffsize) < 0){
+            LOGE(P_EmbUI, printf, "checksum mismatch: %s\n", filepath);
+            jfile.close();
+            return jfile;
+        }
+
+        jfile.seek(0);
+        return jfile;
+    }
+
+    DeserializationError deserializeFileAtomic(JsonDocument& doc, const char* filepath, uint32_t* crc, size_t buffsize){
+        if (!filepath || !*filepath)
+            return DeserializationError::Code::InvalidInput;
+        if (crc) *crc = 0;
+
+        uint32_t c;
+        File jfile = open_atomic(filepath, c, buffsize);
+        if (!jfile)
+            return DeserializationError::Code::InvalidInput;
+
+        DeserializationError error = deserializeAny(doc, jfile, buffsize);
+        if (error)
+            LOGE(P_EmbUI, printf, T_deserialize_err, filepath, error.c_str());
+        else if (crc)
+            *crc = c;
+        return error;
+    }
+
+    JsonVariantConst query(JsonDocument& doc, const char* filepath, std::string_view path, size_t buffsize){
+        doc.clear();
+        if (!filepath || !*filepath) return {};
+
+        uint32_t c;
+        File jfile = open_atomic(filepath, c, buffsize);
+        if (!jfile) return {};
+
+        // filter has the same chain of keys as the path with 'true' at the end
+        JsonDocument filter(embui_mem::allocator(embui_mem::subsys_t::misc));
+        JsonVariant node = filter.to<JsonVariant>();
+        for (std::string_view p = path; !p.empty(); ){
+            size_t dot = p.find('.');
+            node = node[p.substr(0, dot)].to<JsonVariant>();
+            p = dot == std::string_view::npos ? std::string_view() : p.substr(dot + 1);
+        }
+        node.set(true);
+
+        DeserializationError error = deserializeAny(doc, jfile, filter, buffsize);
+        if (error){
+            LOGE(P_EmbUI, printf, T_deserialize_err, filepath, error.c_str());
+            return {};
+        }
+
+        JsonVariantConst v = doc.as<JsonVariantConst>();
+        for (std::string_view p = path; !p.empty() && !v.isNull(); ){
+            size_t dot = p.find('.');
+            v = v[p.substr(0, dot)];
+            p = dot == std::string_view::npos ? std::string_view() : p.substr(dot + 1);
+        }
+        return v;
+    }
+
+    size_t content_size(File& f){
+        uint32_t crc;
+        size_t size = f.size();
+        bool trailer = read_trailer(f, crc);
+        f.seek(0);
+        return trailer ? size - EMBUIFS_CRC_TRAILER_LEN : size;
+    }
+
     void obj_merge(JsonObject dst, JsonObjectConst src){
         for (JsonPairConst kvp : src){
             dst[kvp.key()] = kvp.value();
@@ -47,4 +293,20 @@ namespace embuifs {
             dst.set(src);
     }
 
-}
\ No newline at end of file
+    void deepcopy(JsonVariant dst, JsonVariantConst src){
+        if (src.is<JsonObjectConst>()){
+            JsonObject obj = dst.to<JsonObject>();
+            for (JsonPairConst kv : src.as<JsonObjectConst>())
+                deepcopy(obj[std::string(kv.key().c_str(), kv.key().size())].to<JsonVariant>(), kv.value());
+        } else if (src.is<JsonArrayConst>()){
+            JsonArray arr = dst.to<JsonArray>();
+            for (JsonVariantConst v : src.as<JsonArrayConst>())
+                deepcopy(arr.add<JsonVariant>(), v);
+        } else if (src.is<JsonString>()){
+            JsonString str = src.as<JsonString>();
+            dst.set(std::string(str.c_str(), str.size()));
+        } else
+            dst.set(src);
+    }
+
+}
@@ -10,17 +10,70 @@
 
 #pragma once
 
+#include <string_view>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 #include "StreamUtils.h"
 
 #define EMBUIFS_FILE_WRITE_BUFF_SIZE    256
 
+// write config files in binary MessagePack format instead of json text (1), loading detects format automatically
+#ifndef EMBUIFS_CFG_MSGPACK
+#define EMBUIFS_CFG_MSGPACK             0
+#endif
+
 /**
  * @brief A namespace for various functions to help working with files on LittleFS system
  * 
  */
 namespace embuifs{
+    /**
+     * @brief header of MessagePack files
+     * 0xc1 is never used in MessagePack and can't start a json text, followed by "EU" and format version
+     */
+    static constexpr uint8_t msgpack_hdr[] = {0xc1, 0x45, 0x55, 1};
+
+    /**
+     * @brief deserialize json or MessagePack (with msgpack_hdr header) data from file's current position
+     * 
+     * @param dst destination
+     * @param f file
+     * @param buffsize read buffer size
+     */
+    template <typename TDestination>
+    DeserializationError deserializeAny(TDestination&& dst, File& f, size_t buffsize = EMBUIFS_FILE_WRITE_BUFF_SIZE){
+        if (f.peek() == msgpack_hdr[0]){
+            uint8_t hdr[sizeof(msgpack_hdr)];
+            if (f.read(hdr, sizeof(hdr)) != sizeof(hdr) || memcmp(hdr, msgpack_hdr, sizeof(hdr)))
+                return DeserializationError::Code::InvalidInput;        // unknown format version
+            ReadBufferingStream bufferingStream(f, buffsize);
+            return deserializeMsgPack(dst, bufferingStream);
+        }
+        ReadBufferingStream bufferingStream(f, buffsize);
+        return deserializeJson(dst, bufferingStream);
+    }
+
+    /**
+     * @brief deserialize json or MessagePack data from file's current position keeping only the parts that match filter
+     * 
+     * @param dst destination
+     * @param f file
+     * @param filter filter document, see https://arduinojson.org/v7/api/json/deserializejson/#filtering
+     * @param buffsize read buffer size
+     */
+    template <typename TDestination>
+    DeserializationError deserializeAny(TDestination&& dst, File& f, JsonVariantConst filter, size_t buffsize = EMBUIFS_FILE_WRITE_BUFF_SIZE){
+        if (f.peek() == msgpack_hdr[0]){
+            uint8_t hdr[sizeof(msgpack_hdr)];
+            if (f.read(hdr, sizeof(hdr)) != sizeof(hdr) || memcmp(hdr, msgpack_hdr, sizeof(hdr)))
+                return DeserializationError::Code::InvalidInput;        // unknown format version
+            ReadBufferingStream bufferingStream(f, buffsize);
+            return deserializeMsgPack(dst, bufferingStream, DeserializationOption::Filter(filter));
+        }
+        ReadBufferingStream bufferingStream(f, buffsize);
+        return deserializeJson(dst, bufferingStream, DeserializationOption::Filter(filter));
+    }
+
     /**
      *  метод загружает и пробует десериализовать джейсон из файла в предоставленный документ,
      *  возвращает true если загрузка и десериализация прошла успешно
@@ -40,8 +93,7 @@ namespace embuifs{
             return DeserializationError::Code::InvalidInput;
         }
 
-        ReadBufferingStream bufferingStream(jfile, buffsize);
-        return deserializeJson(dst, bufferingStream);
+        return deserializeAny(dst, jfile, buffsize);
         /*
         DeserializationError error = deserializeJson(doc, bufferingStream);
         if (!error) return error;
@@ -73,8 +125,7 @@ namespace embuifs{
             return DeserializationError::Code::InvalidInput;
         }
 
-        ReadBufferingStream bufferingStream(jfile, buffsize);
-        return deserializeJson(dst, jfile, DeserializationOption::Filter(filter));
+        return deserializeAny(dst, jfile, filter, buffsize);
         /*
         DeserializationError error = deserializeJson(doc, jfile, DeserializationOption::Filter(filter));
         if (!error) return error;
@@ -92,6 +143,67 @@ namespace embuifs{
      */
     size_t serialize2file(JsonVariantConst v, const char* filepath, size_t buffsize = EMBUIFS_FILE_WRITE_BUFF_SIZE);
 
+    /**
+     * @brief crash-safe serialize and write JsonDocument to a file
+     * data is written to a temporary file followed by a trailing CRC32 line, then temp file is renamed
+     * over the destination. So a reset at any moment leaves either an old or a new complete copy of the file.
+     * If content's checksum matches the one of previously saved content, file is not rewritten at all
+     * 
+     * @param v to serialize
+     * @param filepath to write to
+     * @param crc (optional) checksum of the previously saved content, updated on successful write
+     * @param msgpack write binary MessagePack with msgpack_hdr header instead of json text
+     * @return size_t bytes written, 0 if write was skipped or failed
+     */
+    size_t serialize2fileAtomic(JsonVariantConst v, const char* filepath, uint32_t* crc = nullptr, bool msgpack = EMBUIFS_CFG_MSGPACK, size_t buffsize = EMBUIFS_FILE_WRITE_BUFF_SIZE);
+
+    /**
+     * @brief crash-safe write same as serialize2fileAtomic(), but file is written in background by FSWriter
+     * data is serialized to RAM right away, so the source could be changed or destroyed after the call.
+     * Falls back to serialize2fileAtomic() if background writer is disabled with EMBUI_FS_ASYNC or it's queue is full
+     * 
+     * @param v to serialize
+     * @param filepath to write to
+     * @param crc (optional) checksum of the previously saved content, updated once the write is complete, must outlive the write
+     * @param msgpack write binary MessagePack with msgpack_hdr header instead of json text
+     * @return size_t bytes handed over to writer, 0 if write was skipped or failed
+     */
+    size_t serialize2fileAsync(JsonVariantConst v, const char* filepath, uint32_t* crc = nullptr, bool msgpack = EMBUIFS_CFG_MSGPACK);
+
+    /**
+     * @brief load file written with serialize2fileAtomic() or serialize2fileAsync()
+     * pending background write of the file is waited for. A complete temp file left by an interrupted write is considered to be the newest copy and replaces the destination,
+     * file's checksum is verified prior to parsing. Files without checksum trailer are just parsed as usual.
+     * Both json and MessagePack files are accepted
+     * 
+     * @param doc destination document
+     * @param filepath to load
+     * @param crc (optional) checksum of the loaded content, 0 if file has no checksum
+     * @return DeserializationError, InvalidInput if file does not exist or checksum does not match
+     */
+    DeserializationError deserializeFileAtomic(JsonDocument& doc, const char* filepath, uint32_t* crc = nullptr, size_t buffsize = EMBUIFS_FILE_WRITE_BUFF_SIZE);
+
+    /**
+     * @brief load only a subtree of a file addressed by a dot-separated path of object keys, i.e. "embuium.ns.unit.x.page.cfg"
+     * file is streamed through a read buffer and filtered while parsing, so that memory is spent on the result only.
+     * Files written with serialize2fileAtomic() are handled same way as deserializeFileAtomic() does, including checksum verification
+     * 
+     * @param doc destination document, keeps the subtree and the keys leading to it
+     * @param filepath file to read
+     * @param path path to the subtree, an empty path selects the whole file
+     * @return JsonVariantConst matched subtree within doc, null if file can't be loaded or has no such path
+     */
+    JsonVariantConst query(JsonDocument& doc, const char* filepath, std::string_view path, size_t buffsize = EMBUIFS_FILE_WRITE_BUFF_SIZE);
+
+    /**
+     * @brief size of file's content without checksum trailer added by serialize2fileAtomic(), i.e. to serve it to other parties
+     * only trailer's format is checked, not the checksum. File is rewound to the start
+     * 
+     * @param f file
+     * @return size_t content size
+     */
+    size_t content_size(File& f);
+
     /**
      * @brief shallow merge objects
      * from https://arduinojson.org/v6/how-to/merge-json-objects/
@@ -109,4 +221,13 @@ namespace embuifs{
      * @param src 
      */
     void obj_deepmerge(JsonVariant dst, JsonVariantConst src);
+
+    /**
+     * @brief deep copy a variant making own copies of all keys and strings
+     * ArduinoJson before 7.3 keeps a const char* by pointer, a plain copy of such a variant would point to the source's memory
+     * 
+     * @param dst 
+     * @param src 
+     */
+    void deepcopy(JsonVariant dst, JsonVariantConst src);
 }
\ No newline at end of file
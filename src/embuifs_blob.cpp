@@ -0,0 +1,116 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#include <algorithm>
+#include "embuifs_blob.hpp"
+#include "embui_log.h"
+#ifndef ESP_PLATFORM
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace embuifs {
+
+bool BlobPack::_validate() const {
+    if (_size < sizeof(header_t) || _hdr()->magic != _magic || _hdr()->version != _version) return false;
+    size_t cnt = _hdr()->count;
+    if (_size < sizeof(header_t) + cnt * sizeof(entry_t)) return false;
+    for (size_t i = 0; i != cnt; ++i){
+        const entry_t* e = _entry(i);
+        if (e->name[sizeof(e->name) - 1] || e->offset > _size || e->size > _size - e->offset) return false;
+    }
+    return true;
+}
+
+#ifdef ESP_PLATFORM
+bool BlobPack::map(const char* label){
+    unmap();
+    const esp_partition_t* part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!part){
+        LOGD(P_EmbUI, printf, "no blobs partition '%s'\n", label);
+        return false;
+    }
+
+    // read index first to find out how much of partition has to be mapped
+    header_t h{};
+    if (esp_partition_read(part, 0, &h, sizeof(h)) != ESP_OK || h.magic != _magic || h.version != _version){
+        LOGW(P_EmbUI, printf, "partition '%s' has no blobs pack\n", label);
+        return false;
+    }
+    size_t len = sizeof(h) + h.count * sizeof(entry_t);
+    for (size_t i = 0; i != h.count && len <= part->size; ++i){
+        entry_t e;
+        if (esp_partition_read(part, sizeof(h) + i * sizeof(entry_t), &e, sizeof(e)) != ESP_OK) return false;
+        len = std::max<size_t>(len, static_cast<size_t>(e.offset) + e.size);
+    }
+    if (len > part->size){
+        LOGE(P_EmbUI, printf, "blobs pack exceeds partition '%s'\n", label);
+        return false;
+    }
+
+    const void* ptr{nullptr};
+    if (esp_partition_mmap(part, 0, len, ESP_PARTITION_MMAP_DATA, &ptr, &_hndl) != ESP_OK){
+        LOGE(P_EmbUI, printf, "can't mmap partition '%s'\n", label);
+        return false;
+    }
+    _base = static_cast<const uint8_t*>(ptr);
+    _size = len;
+    if (!_validate()){
+        LOGE(P_EmbUI, printf, "blobs pack in '%s' is damaged\n", label);
+        unmap();
+        return false;
+    }
+    LOGI(P_EmbUI, printf, "mapped %u blobs from '%s', %u bytes\n", count(), label, _size);
+    return true;
+}
+
+void BlobPack::unmap(){
+    if (_base) esp_partition_munmap(_hndl);
+    _base = nullptr;
+    _size = 0;
+    _hndl = 0;
+}
+#else
+bool BlobPack::map(const char* path){
+    unmap();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void* ptr = fstat(fd, &st) || !st.st_size ? MAP_FAILED : mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // mapping stays valid after descriptor is closed
+    close(fd);
+    if (ptr == MAP_FAILED) return false;
+    _base = static_cast<const uint8_t*>(ptr);
+    _size = st.st_size;
+    if (!_validate()){
+        unmap();
+        return false;
+    }
+    return true;
+}
+
+void BlobPack::unmap(){
+    if (_base) munmap(const_cast<uint8_t*>(_base), _size);
+    _base = nullptr;
+    _size = 0;
+}
+#endif
+
+BlobPack::blob_t BlobPack::get(std::string_view name) const {
+    for (size_t i = 0; i != count(); ++i){
+        const entry_t* e = _entry(i);
+        if (name == e->name) return { _base + e->offset, e->size };
+    }
+    return {};
+}
+
+}   // namespace embuifs
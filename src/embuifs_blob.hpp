@@ -0,0 +1,139 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include "embuifs.hpp"
+#include "embui_defines.h"
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#endif
+
+namespace embuifs {
+
+/**
+ * @brief read-only pack of blobs mapped to address space
+ * Blobs are accessed in place, without reading them to RAM, on target pack is a flash data partition mapped via MMU,
+ * on Linux host it is a file mapped with mmap().
+ * Pack layout (little-endian, built with resources/blobpack.py):
+ *   header {magic "EUIB", version u16, count u16}
+ *   count x entry {name[EMBUIFS_BLOB_NAME_LEN], offset u32, size u32}, offset is from the start of the pack
+ *   blobs data
+ */
+class BlobPack {
+public:
+    // blob's content, valid while pack is mapped
+    struct blob_t {
+        const uint8_t* data{nullptr};
+        size_t size{0};
+        explicit operator bool() const { return data; }
+        std::string_view str() const { return {reinterpret_cast<const char*>(data), size}; }
+    };
+
+private:
+    static constexpr uint32_t _magic = 0x42495545;     // "EUIB"
+    static constexpr uint16_t _version = 1;
+
+    struct header_t {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t count;
+    };
+
+    struct entry_t {
+        char name[EMBUIFS_BLOB_NAME_LEN];
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    const uint8_t* _base{nullptr};
+    size_t _size{0};
+#ifdef ESP_PLATFORM
+    esp_partition_mmap_handle_t _hndl{0};
+#endif
+
+    // check header and index against mapped size
+    bool _validate() const;
+
+    const header_t* _hdr() const { return reinterpret_cast<const header_t*>(_base); }
+    const entry_t* _entry(size_t idx) const { return reinterpret_cast<const entry_t*>(_base + sizeof(header_t)) + idx; }
+
+public:
+    BlobPack() = default;
+    BlobPack(BlobPack const&) = delete;
+    void operator=(BlobPack const&) = delete;
+    ~BlobPack(){ unmap(); }
+
+#ifdef ESP_PLATFORM
+    /**
+     * @brief map pack from flash data partition
+     * only the part of partition occupied by the pack is mapped
+     *
+     * @param label partition label
+     * @return true if partition holds a valid pack
+     */
+    bool map(const char* label = EMBUIFS_BLOB_PARTITION);
+#else
+    /**
+     * @brief map pack from file
+     *
+     * @param path pack file's path
+     * @return true if file holds a valid pack
+     */
+    bool map(const char* path);
+#endif
+
+    void unmap();
+
+    bool mapped() const { return _base; }
+
+    // number of blobs in pack
+    size_t count() const { return _base ? _hdr()->count : 0; }
+
+    /**
+     * @brief find blob by name
+     *
+     * @param name blob's name, i.e. "/js/ui_embui.json"
+     * @return blob_t, empty if not found
+     */
+    blob_t get(std::string_view name) const;
+};
+
+/**
+ * @brief deserialize json or MessagePack (with msgpack_hdr header) blob
+ * data is parsed right from mapped memory, no FS read buffer or heap copy of the blob is made,
+ * only the resulting document is allocated, use filter to keep it small for large blobs.
+ * ArduinoJson v7 has no zero-copy mode and always copies strings to document
+ *
+ * @param dst destination
+ * @param blob blob
+ * @param filter filter document, a null variant means no filtering
+ */
+template <typename TDestination>
+DeserializationError deserializeBlob(TDestination&& dst, const BlobPack::blob_t& blob, JsonVariantConst filter = JsonVariantConst()){
+    if (!blob) return DeserializationError::Code::EmptyInput;
+    // const pointers, so that ArduinoJson treats input as read-only
+    const uint8_t* data = blob.data;
+    size_t size = blob.size;
+    if (size && data[0] == msgpack_hdr[0]){
+        if (size < sizeof(msgpack_hdr) || std::memcmp(data, msgpack_hdr, sizeof(msgpack_hdr)))
+            return DeserializationError::Code::InvalidInput;        // unknown format version
+        data += sizeof(msgpack_hdr);
+        size -= sizeof(msgpack_hdr);
+        return filter.isNull() ? deserializeMsgPack(dst, data, size) : deserializeMsgPack(dst, data, size, DeserializationOption::Filter(filter));
+    }
+    const char* text = reinterpret_cast<const char*>(data);
+    return filter.isNull() ? deserializeJson(dst, text, size) : deserializeJson(dst, text, size, DeserializationOption::Filter(filter));
+}
+
+}   // namespace embuifs
@@ -24,6 +24,82 @@ void ota_handler(AsyncWebServerRequest *request, String filename, size_t index,
  */
 //uint8_t uploadProgress(size_t len, size_t total);
 
+/**
+ * @brief serves files from mapped blobs pack right from flash, without reading them to RAM
+ * a blob named as request's url or url + ".gz" is served, otherwise request is passed to next handlers
+ */
+class BlobHandler : public AsyncWebHandler {
+    const embuifs::BlobPack& _pack;
+
+    static const char* _mime(std::string_view path){
+        static constexpr std::pair<std::string_view, const char*> types[] = {
+            {".html", "text/html"}, {".js", "application/javascript"}, {".css", "text/css"}, {".json", "application/json"},
+            {".svg", "image/svg+xml"}, {".png", "image/png"}, {".ico", "image/x-icon"}
+        };
+        for (const auto& t : types)
+            if (path.ends_with(t.first)) return t.second;
+        return "application/octet-stream";
+    }
+
+public:
+    explicit BlobHandler(const embuifs::BlobPack& pack) : _pack(pack) {}
+
+    bool canHandle(AsyncWebServerRequest *request) const override {
+        if (!(request->method() & (HTTP_GET | HTTP_HEAD)) || !_pack.mapped()) return false;
+        return _pack.get(request->url().c_str()) || _pack.get((request->url() + ".gz").c_str());
+    }
+
+    void handleRequest(AsyncWebServerRequest *request) override {
+        std::string_view path(request->url().c_str());
+        auto blob = _pack.get(path);
+        bool gz = !blob;
+        if (gz) blob = _pack.get((request->url() + ".gz").c_str());
+        if (!blob){
+            request->send(404);
+            return;
+        }
+        AsyncWebServerResponse *response = request->beginResponse(200, _mime(path), blob.data, blob.size);
+        if (gz) response->addHeader("Content-Encoding", "gzip");
+        request->send(response);
+    }
+};
+
+/**
+ * @brief serves json files written with embuifs::serialize2fileAtomic() from LittleFS without their checksum trailer,
+ * so that browsers and backup tools get valid json. Other files are left to static files handler
+ */
+class JsonFileHandler : public AsyncWebHandler {
+    // open json file if it has a checksum trailer
+    static File _open(AsyncWebServerRequest *request, size_t& len){
+        if (!request->url().endsWith(".json") || !LittleFS.exists(request->url())) return File();
+        File f = LittleFS.open(request->url());
+        if (!f || f.isDirectory() || f.peek() == embuifs::msgpack_hdr[0]) return File();
+        len = embuifs::content_size(f);
+        return len == f.size() ? File() : f;
+    }
+
+public:
+    bool canHandle(AsyncWebServerRequest *request) const override {
+        if (!(request->method() & (HTTP_GET | HTTP_HEAD))) return false;
+        size_t len;
+        return static_cast<bool>(_open(request, len));
+    }
+
+    void handleRequest(AsyncWebServerRequest *request) override {
+        size_t len{0};
+        auto f = std::make_shared<File>(_open(request, len));
+        if (!*f){
+            request->send(404);
+            return;
+        }
+        AsyncWebServerResponse *response = request->beginResponse(asyncsrv::T_application_json, len, [f, len](uint8_t *buffer, size_t maxlen, size_t index) -> size_t {
+            return index < len ? f->read(buffer, std::min(maxlen, len - index)) : 0;
+        });
+        response->addHeader(asyncsrv::T_Cache_Control, asyncsrv::T_no_cache);
+        request->send(response);
+    }
+};
+
 // default 404 handler
 void EmbUI::_notFound(AsyncWebServerRequest *request) {
 
@@ -60,7 +136,7 @@ void EmbUI::_http_set_handlers(){
 
     // postponed reboot (TODO: convert to CMD)
     server.on("/restart", HTTP_ANY, [this](AsyncWebServerRequest *request) {
-        Task *t = new Task(TASK_SECOND*5, TASK_ONCE, nullptr, &ts, false, nullptr, [](){ ESP.restart(); });
+        Task *t = new Task(TASK_SECOND*5, TASK_ONCE, nullptr, &ts, false, nullptr, [](){ PersistManager::getInstance().flush(); ESP.restart(); });
         t->enableDelayed();
         request->redirect("/");
     });
@@ -74,6 +150,13 @@ void EmbUI::_http_set_handlers(){
     fz.provide_ota_form(&server, UPDATE_URI);
     fz.handle_ota_form(&server, UPDATE_URI);
 
+    // files from blobs pack take precedence over the ones on LittleFS
+    if (blobs.mapped())
+        server.addHandler(new BlobHandler(blobs));
+
+    // config files are served without checksum trailer
+    server.addHandler(new JsonFileHandler());
+
     // serve all static files from LittleFS root /
     server.serveStatic("/", LittleFS, "/")
         .setDefaultFile("index.html")
@@ -133,41 +133,17 @@ void EmbUI::_onMqttMessage(char* topic, char* payload, AsyncMqttClientMessagePro
         tpc.remove_prefix(mqttPrefix().length());
 */
 
-    // this is a dublicate code same as for WS, need to implement a proper queue for such data
-
-    JsonDocument *res = new JsonDocument();
-    if(!res)
-        return;
-
-    DeserializationError error = deserializeJson((*res), (const char*)payload, len); // deserialize via copy to prevent dangling pointers in action()'s
-    if (error){
-        LOGD(P_EmbUI_mqtt, printf, "MQTT: msg deserialization err: %d\n", error.code());
-        delete res;
-        return;
-    }
-
     tpc.remove_prefix(mqttPrefix().length());     // chop off constant prefix
 
     if (starts_with(tpc, C_get) || starts_with(tpc, C_set)){
         std::string act(tpc.substr(4));                     // chop off 'get/' or 'set/' prefix
         std::replace( act.begin(), act.end(), '/', '_');    // replace topic delimiters into underscores
-        JsonObject o = res->as<JsonObject>();
-        o[P_action] = act;                                  // set action identifier
+        ingress(payload, len, act.c_str());
+        return;
     }
 
     // switch context for processing data
-    Task *t = new Task(10, TASK_ONCE,
-        [res](){
-            JsonObject o = res->as<JsonObject>();
-            // call action handler for post'ed data
-            embui.post(o);
-            delete res; },
-        &ts, false, nullptr, nullptr, true
-    );
-    if (t)
-        t->enableDelayed();
-
-
+    ingress(payload, len);
 }
 
 void EmbUI::_mqttSubscribe(){
@@ -193,7 +169,12 @@ void EmbUI::publish(const char* topic, const JsonVariantConst data, bool retaine
     auto s = measureJson(data);
     std::vector<uint8_t> buff(s);
     serializeJson(data, static_cast<unsigned char*>(buff.data()), s);
-    mqttClient->publish(_mqttMakeTopic(topic).data(), 0, retained, reinterpret_cast<const char*>(buff.data()), buff.size());
+    publish(topic, buff.data(), buff.size(), retained);
+}
+
+void EmbUI::publish(const char* topic, const uint8_t* payload, size_t length, bool retained){
+    if (!mqttAvailable()) return;
+    mqttClient->publish(_mqttMakeTopic(topic).data(), 0, retained, reinterpret_cast<const char*>(payload), length);
 }
 
 void EmbUI::_mqtt_pub_sys_status(){
@@ -204,6 +185,33 @@ void EmbUI::_mqtt_pub_sys_status(){
     publish((t + "heap_free").c_str(), ESP.getFreeHeap()/1024);
     publish((t + "uptime").c_str(), esp_timer_get_time() / 1000000);
     publish((t + "rssi").c_str(), WiFi.RSSI());
+
+    // JsonDocuments memory usage by subsystems, bytes
+    for (size_t i = 0; i != static_cast<size_t>(embui_mem::subsys_t::count); ++i){
+        auto s = static_cast<embui_mem::subsys_t>(i);
+        publish((t + "mem_" + embui_mem::name(s)).c_str(), embui_mem::stats(s).used);
+    }
+    // values dropped due to value bus overflow
+    publish((t + "bus_drops").c_str(), bus.drops());
+    // async action workers
+    auto w = WorkerPool::getInstance().stats();
+    publish((t + "workers_queue").c_str(), w.queued);
+    publish((t + "workers_busy").c_str(), w.running);
+    publish((t + "workers_util").c_str(), WorkerPool::getInstance().utilization());
+    // handle() tick duration percentiles since previous publish, us
+    auto l = loopStats();
+    loopStatsReset();
+    publish((t + "loop_p50").c_str(), l.p50);
+    publish((t + "loop_p99").c_str(), l.p99);
+    publish((t + "loop_max").c_str(), l.max);
+    // bytes written to flash per file
+    JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::misc));
+    PersistManager::getInstance().report(doc.to<JsonObject>());
+    publish((t + "persist").c_str(), doc);
+    // background FS writer, time spent on flash writes off the EmbUI's task
+    auto fsw = FSWriter::getInstance().stats();
+    publish((t + "fs_queue").c_str(), fsw.queued);
+    publish((t + "fs_write_max_us").c_str(), fsw.max_us);
 }
 
 std::string EmbUI::_mqttMakeTopic(const char* topic){
@@ -227,4 +235,9 @@ void FrameSendMQTT::send(const JsonVariantConst& data){
 
     // all other packet types are ignored, user supposed to create it's own FrameSendMQTT instances if required 
     //_eu->publish(C_pub_etc, data);
-}
\ No newline at end of file
+}
+
+void FrameSendMQTT::send(const AsyncWebSocketSharedBuffer& data){
+    if (data)
+        _eu->publish(C_pub_iface, data->data(), data->size());
+}
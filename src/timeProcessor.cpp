@@ -233,6 +233,7 @@ void TimeProcessor::attach_callback(callback_function_t callback){
 #ifdef EMBUI_WORLDTIMEAPI
 
 #include <ArduinoJson.h>
+#include "embui_mem.hpp"
 #ifdef ESP32
 #include <HTTPClient.h>
 #endif
@@ -279,7 +280,7 @@ void WorldTimeAPI::getTimeHTTP()
     }
 
     LOGV(P_EmbUI_time, println, result);
-    DynamicJsonDocument doc(TIMEAPI_BUFSIZE);
+    JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::misc));
     DeserializationError error = deserializeJson(doc, result);
     result="";
 
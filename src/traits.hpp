@@ -16,6 +16,7 @@
 // type traits I use for various literals
 
 #pragma once
+#include <string_view>
 #include <type_traits>
 #include "ArduinoJson.h"
 
@@ -26,6 +27,21 @@ e2int(E e) {
     return static_cast<std::common_type_t<int, std::underlying_type_t<E>>>(e);
 }
 
+// literals hashing
+// https://learnmoderncpp.com/2020/06/01/strings-as-switch-case-labels/
+
+inline constexpr auto hash_djb2a(const std::string_view sv) {
+    unsigned long hash{ 5381 };
+    for (unsigned char c : sv) {
+      hash = ((hash << 5) + hash) ^ c;
+    }
+    return hash;
+}
+
+inline constexpr auto operator"" _sh(const char *str, size_t len) {
+    return hash_djb2a(std::string_view{ str, len });
+}
+
 // std::string_view.ends_with before C++20
 bool ends_with(std::string_view str, std::string_view sv);
 
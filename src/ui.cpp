@@ -5,10 +5,20 @@
 
 #include "ui.h"
 #include "embuifs.hpp"
+#include "embui_egress.hpp"
 
 static constexpr const char* MGS_empty_stack =  "no opened section for an object!";
 static constexpr const char* MGS_no_store =  "no-store";
 
+/**
+ * @brief ArduinoJson writer that appends to a byte vector
+ */
+struct VectorWriter {
+    std::vector<uint8_t> &v;
+    size_t write(uint8_t c){ v.push_back(c); return 1; }
+    size_t write(const uint8_t* s, size_t n){ v.insert(v.end(), s, s + n); return n; }
+};
+
 Interface::~Interface(){
     json_frame_clear();
     if (_delete_handler_on_destruct){
@@ -30,6 +40,8 @@ JsonObject Interface::json_object_add(const JsonVariantConst obj){
 
     //(section_stack.size() ? section_stack.back().block.add<JsonObject>() : json.as<JsonObject>())
     if (!section_stack.size()) { LOGW(P_EmbUI, println, MGS_empty_stack); return {}; }
+    _json_budget_check();
+    if (_streaming) _stream_emit(section_stack.back().block);
     if ( section_stack.back().block.add(obj) ){
         LOGV(P_EmbUI, printf, "...OK idx:%u\theap free: %u\n", section_stack.back().idx, ESP.getFreeHeap());
         section_stack.back().idx++;        // incr idx for next obj
@@ -40,6 +52,10 @@ JsonObject Interface::json_object_add(const JsonVariantConst obj){
 
 JsonObject Interface::json_frame(const char* type, const char* section_id){
     json_frame_flush();         // ensure to start a new frame purging any existing data
+    _value_frame = !std::strcmp(type, P_value);
+    // page is (re)created for all clients, values has to be published again
+    if (!_unicast && !std::strcmp(type, P_interface))
+        ValueCache::getInstance().invalidate();
     json[P_pkg] = type;
     json[P_final] = false;
     json_section_begin(section_id);
@@ -48,11 +64,29 @@ JsonObject Interface::json_frame(const char* type, const char* section_id){
 
 void Interface::json_frame_clear(){
     section_stack.clear();
+    _sections_dropped = 0;
     json.clear();
+    _obuff.reset();
+    _frame_bytes = 0;
+    _value_frame = false;
+}
+
+void Interface::json_frame_budget(size_t bytes){
+    _budget = bytes;
+}
+
+void Interface::json_frame_streaming(bool enable){
+    if (section_stack.size()) return;
+    _streaming = enable;
 }
 
 void Interface::json_frame_flush(){
     if (!section_stack.size()) return;
+    // delta value frame has no changed values, nothing to send
+    if (_vdelta && _value_frame && section_stack.size() == 1 && !section_stack.front().idx){
+        json_frame_clear();
+        return;
+    }
     json[P_final] = true;
     json_section_end();
     LOGD(P_EmbUI, println, "json_frame_flush");
@@ -60,49 +94,237 @@ void Interface::json_frame_flush(){
     json_frame_clear();
 }
 
+void Interface::json_frame_static(const char* frame, size_t len, const char* type){
+    if (!frame) return;
+    json_frame_static(std::make_shared< std::vector<uint8_t> >(frame, frame + len), type);
+}
+
+void Interface::json_frame_static(const AsyncWebSocketSharedBuffer& frame, const char* type){
+    json_frame_flush();
+    if (!send_hndl || !frame) return;
+    // page is (re)created for all clients, values has to be published again
+    if (!_unicast && !std::strcmp(type, P_interface))
+        ValueCache::getInstance().invalidate();
+
+    // header is used by feeders to classify the frame
+    json[P_pkg] = type;
+    send_hndl->send(frame, json);
+    json.clear();
+}
+
+FrameSend* Interface::feeder(FrameSend *feeder){
+    json_frame_flush();
+    FrameSend *prev = send_hndl;
+    send_hndl = feeder;
+    return prev;
+}
+
 void Interface::json_frame_send(){
     _json_frame_send();
     _json_frame_next();
 }
 
+void Interface::_json_frame_send(){
+    if (!send_hndl) return;
+    if (!_streaming) return send_hndl->send(json);
+    if (!_obuff) return;
+
+    // close all sections that are still opened, from the innermost to the root one
+    for (auto i = section_stack.rbegin(); i != section_stack.rend(); ++i){
+        auto parent = std::next(i);
+        JsonObjectConst section = parent == section_stack.rend() ? json.as<JsonObjectConst>() : JsonObjectConst((*parent).block[(*parent).block.size()-1]);
+        // the only object left in outer section's block is the nested section, it is already in output buffer
+        if (i == section_stack.rbegin())
+            _stream_section_close((*i).block, section);
+        else
+            _stream_section_tail(section);
+    }
+    send_hndl->send(_obuff, json);
+}
+
 void Interface::_json_frame_next(){
     if (!section_stack.size()) return;
-    json.clear();
-    JsonObject obj = json.to<JsonObject>();
-    if (section_stack.size() > 1){
-        size_t idx{0};
-        for ( auto i = section_stack.begin(); i != section_stack.end(); ++i ){
-            if (idx++)
-                obj = (*std::prev(i)).block.add<JsonObject>();
-            obj[P_section] = (*i).name;
-            obj[P_idx] = (*i).idx;
-            (*i).block = obj[P_block].to<JsonArray>();
-            //LOG(printf, "nesting section:'%s' [#%u] idx:%u\n", section_stack[i]->name.isEmpty() ? "-" : section_stack[i]->name.c_str(), i, section_stack[i]->idx);
+    _frame_bytes = 0;
+    if (_streaming) _obuff.reset();
+
+    for ( auto i = section_stack.begin(); i != section_stack.end(); ++i ){
+        JsonObject obj = i == section_stack.begin() ? json.as<JsonObject>() : JsonObject((*std::prev(i)).block[(*std::prev(i)).block.size()-1]);
+        // section name is kept, stack entry refers to it
+        for (auto kv = obj.begin(); kv != obj.end(); ){
+            auto cur = kv;
+            ++kv;
+            const char* key = (*cur).key().c_str();
+            if (std::strcmp(key, P_block) && std::strcmp(key, P_section) && (i != section_stack.begin() || std::strcmp(key, P_pkg)))
+                obj.remove(cur);
         }
+        obj[P_idx] = (*i).idx;
+
+        JsonArray block = (*i).block;
+        // leave nested section object, it is the last one in a block
+        while (block.size() > (std::next(i) == section_stack.end() ? 0 : 1))
+            block.remove(0);
+
+        if (_streaming) _stream_section_open();
     }
     LOGI(P_EmbUI, printf, "json_frame_next: [#%d]\n", section_stack.size()-1);   // section index counts from 0
 }
 
+bool Interface::_section_available(){
+    if (!section_stack.full()) return true;
+    ++_sections_dropped;
+    LOGE(P_EmbUI, printf, "sections stack is full (%u), section dropped\n", section_stack.size());
+    return false;
+}
+
+JsonObject Interface::_json_block_add(){
+    _json_budget_check();
+    if (_streaming) _stream_emit(section_stack.back().block);
+    return section_stack.back().block.add<JsonObject>();
+}
+
+void Interface::_stream_emit(JsonArray block){
+    if (!_obuff || !block.size()) return;
+    VectorWriter w{*_obuff};
+    for (JsonVariantConst v : block){
+        // objects separator, unless it's the first object in a block
+        if (_obuff->back() != '[') _obuff->push_back(',');
+        serializeJson(v, w);
+    }
+    block.clear();
+}
+
+void Interface::_stream_section_open(){
+    // root section starts a new output buffer
+    if (!_obuff){
+        _obuff = std::make_shared< std::vector<uint8_t> >();
+        _obuff->reserve(EMBUI_STREAM_BUFF_RESERVE);
+    } else if (_obuff->back() != '[')
+        _obuff->push_back(',');
+
+    // section's own keys are written on close, so only block's array is opened here
+    static constexpr const char head[] = "{\"block\":[";
+    _obuff->insert(_obuff->end(), head, head + sizeof(head) - 1);
+}
+
+void Interface::_stream_section_close(JsonArray block, JsonObjectConst section){
+    _stream_emit(block);
+    _stream_section_tail(section);
+}
+
+void Interface::_stream_section_tail(JsonObjectConst section){
+    _obuff->push_back(']');
+    // section's keys are appended after the block, key order does not matter for the frame
+    VectorWriter w{*_obuff};
+    for (JsonPairConst kv : section){
+        if (!std::strcmp(kv.key().c_str(), P_block)) continue;
+        // keys are plain identifiers, no need to escape those
+        _obuff->push_back(',');
+        _obuff->push_back('"');
+        _obuff->insert(_obuff->end(), kv.key().c_str(), kv.key().c_str() + kv.key().size());
+        _obuff->push_back('"');
+        _obuff->push_back(':');
+        serializeJson(kv.value(), w);
+    }
+    _obuff->push_back('}');
+}
+
+void Interface::_json_budget_check(){
+    if (!_budget) return;
+
+    if (_streaming){
+        // previous object is complete, dump it and check buffer size
+        _stream_emit(section_stack.back().block);
+        if (!_obuff || _obuff->size() < _budget) return;
+    } else {
+        // previous object is complete, account it's size, sections are accounted by it's nested objects
+        JsonArray block = section_stack.back().block;
+        if (block.size()){
+            JsonVariantConst last = block[block.size()-1];
+            if (!last[P_block].is<JsonArrayConst>())
+                _frame_bytes += measureJson(last);
+        }
+        if (_frame_bytes < _budget) return;
+    }
+
+    LOGD(P_EmbUI, printf, "frame budget %u exceeded, split\n", _budget);
+    _json_frame_split();
+}
+
+void Interface::_json_frame_split(){
+    if (_streaming){
+        // close all opened sections in output buffer with the keys they have so far
+        for (auto i = section_stack.rbegin(); i != section_stack.rend(); ++i){
+            auto parent = std::next(i);
+            _stream_section_tail(parent == section_stack.rend() ? json.as<JsonObjectConst>() : JsonObjectConst((*parent).block[(*parent).block.size()-1]));
+        }
+        if (send_hndl) send_hndl->send(_obuff, json);
+    } else if (send_hndl)
+        send_hndl->send(json);
+
+    // purge sent data, section objects previously returned to the caller remain valid
+    _json_frame_next();
+}
+
 JsonObject Interface::json_frame_value(const JsonVariantConst val){
     json_frame_flush();     // ensure this will purge existing frame
     json_frame(P_value);
-    return json_object_add(val);
+    return value(val);
+}
+
+JsonObject Interface::value(const JsonVariantConst data){
+    // values sent to a single client must not be taken as published to everyone
+    if (_value_frame && !_unicast) ValueCache::getInstance().update(data);
+    return json_object_add(data);
+}
+
+JsonObject Interface::_value_cached(JsonObject o, bool html){
+    if (!_value_frame || _unicast || o.isNull()) return o;
+
+    bool publish;
+    if (html)
+        publish = ValueCache::getInstance().update(o[P_id].as<const char*>(), o[P_value], true, _vdelta);
+    else {
+        JsonPair kv = *o.begin();
+        publish = ValueCache::getInstance().update(kv.key().c_str(), kv.value(), false, _vdelta);
+    }
+    if (publish) return o;
+
+    // value is unchanged, drop it from the frame
+    JsonArray block = section_stack.back().block;
+    block.remove(block.size()-1);
+    --section_stack.back().idx;
+    return {};
 }
 
 void Interface::json_section_end(){
+    // section was not opened, nothing to close
+    if (_sections_dropped){
+        --_sections_dropped;
+        return;
+    }
     if (!section_stack.size()) return;
 
-    section_stack.erase(std::prev( section_stack.end() ));
+    if (_streaming && _obuff){
+        if (section_stack.size() > 1){
+            // nested section object is the last one in parent's block
+            JsonArray parent = (*std::prev(section_stack.end(), 2)).block;
+            _stream_section_close(section_stack.back().block, parent[parent.size()-1]);
+            parent.remove(parent.size()-1);
+        } else
+            _stream_section_close(section_stack.back().block, json.as<JsonObject>());
+    }
+
+    section_stack.pop_back();
     if (section_stack.size()) {
         section_stack.back().idx++;
-        LOGD(P_EmbUI, printf, "section end #%u '%s'\n", section_stack.size(), section_stack.back().name.isEmpty() ? "-" : section_stack.back().name.c_str());
+        LOGD(P_EmbUI, printf, "section end #%u '%s'\n", section_stack.size(), *section_stack.back().name ? section_stack.back().name : "-");
     }
 }
 
 JsonObject Interface::json_object_create(){
     if (!section_stack.size()) { LOGW(P_EmbUI, println, MGS_empty_stack); return JsonObject(); }
     section_stack.back().idx++;        // incr idx for next obj
-    return section_stack.back().block.add<JsonObject>();
+    return _json_block_add();
 }
 
 
@@ -146,21 +368,32 @@ JsonObject Interface::uidata_merge(const char* key, JsonVariantConst data){
     return obj;
 }
 
+AsyncWebSocketSharedBuffer frame_serialize(const JsonVariantConst& data){
+    size_t length = measureJson(data);
+    auto buffer = std::make_shared< std::vector<uint8_t> >(length);
+    serializeJson(data, reinterpret_cast<char*>(buffer->data()), length);
+    return buffer;
+}
+
+void FrameSend::send(const AsyncWebSocketSharedBuffer& data, const JsonVariantConst& hdr){
+    if (accepts_raw(hdr)) return send(data);
+    // feeder needs an object, deserialize it back
+    JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::egress));
+    if (deserializeJson(doc, reinterpret_cast<const char*>(data->data()), data->size())) return;
+    send(doc);
+}
+
 /**
  * @brief - serialize and send json obj directly to the ws buffer
  */
 void FrameSendWSServer::send(const JsonVariantConst& data){
     if (!available()) { LOGW(P_EmbUI, println, "FrameSendWSServer::send - not available!"); return; }   // no need to do anything if there is no clients connected
+    WSEgress::getInstance().send(ws, {}, data, data);
+};
 
-    size_t length = measureJson(data);
-    auto buffer = ws->makeBuffer(length);
-    if (!buffer){
-        LOGW(P_EmbUI, println, "FrameSendWSServer::send - no buffer!");
-        return;
-    }
-
-    serializeJson(data, (char*)buffer->get(), length);
-    ws->textAll(buffer);
+void FrameSendWSServer::send(const char* data){
+    if (!data) data = P_empty_quotes;
+    WSEgress::getInstance().send(ws, std::make_shared< std::vector<uint8_t> >(data, data + std::strlen(data)), {});
 };
 
 /**
@@ -168,14 +401,12 @@ void FrameSendWSServer::send(const JsonVariantConst& data){
  */
 void FrameSendWSClient::send(const JsonVariantConst& data){
     if (!available()) return;   // no need to do anything if there is no clients connected
+    WSEgress::getInstance().send(cl, {}, data, data);
+};
 
-    size_t length = measureJson(data);
-    auto buffer = cl->server()->makeBuffer(length);
-    if (!buffer)
-        return;
-
-    serializeJson(data, (char*)buffer->get(), length);
-    cl->text(buffer);
+void FrameSendWSClient::send(const char* data){
+    if (!data) data = P_empty_quotes;
+    WSEgress::getInstance().send(cl, std::make_shared< std::vector<uint8_t> >(data, data + std::strlen(data)), {});
 };
 
 void FrameSendChain::remove(int id){
@@ -196,8 +427,35 @@ int FrameSendChain::add(std::unique_ptr<FrameSend>&& handler){
 }
 
 void FrameSendChain::send(const JsonVariantConst& data){
-    for (auto &i : _hndlr_chain)
+    AsyncWebSocketSharedBuffer buff;
+
+    for (auto &i : _hndlr_chain){
+        if (i.handler->accepts_raw(data)){
+            if (!i.handler->available()) continue;
+            // serialize frame on first demand, then reuse same bytes for all other handlers
+            if (!buff)
+                buff = frame_serialize(data);
+            i.handler->send(buff, data);
+            continue;
+        }
         i.handler->send(data);
+    }
+}
+
+void FrameSendChain::send(const AsyncWebSocketSharedBuffer& data, const JsonVariantConst& hdr){
+    JsonDocument doc(embui_mem::allocator(embui_mem::subsys_t::egress));
+
+    for (auto &i : _hndlr_chain){
+        if (i.handler->accepts_raw(hdr)){
+            if (i.handler->available())
+                i.handler->send(data, hdr);
+            continue;
+        }
+        // deserialize frame on first demand, then reuse same object for all other handlers
+        if (doc.isNull() && deserializeJson(doc, reinterpret_cast<const char*>(data->data()), data->size()))
+            return;
+        i.handler->send(doc);
+    }
 }
 
 void FrameSendChain::send(const char* data){
@@ -214,13 +472,10 @@ void FrameSendAsyncJS::send(const JsonVariantConst& data){
     */
     if (flushed) return;
 
-    response = new AsyncJsonResponse();
-
-    // TODO
-    // this is not beautiful and requres double mem to send Object
-    embuifs::obj_deepmerge(response->getRoot(), data);
-    response->setLength();
-    req->send(response);
+    // serialize frame directly to response stream, no need to keep a copy in AsyncJsonResponse's document
+    AsyncResponseStream* stream = req->beginResponseStream(asyncsrv::T_application_json);
+    serializeJson(data, *stream);
+    req->send(stream);
     flushed = true;
 };
 
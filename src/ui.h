@@ -5,13 +5,19 @@
 
 #pragma once
 
+#include <cstdio>
+#include <iterator>
 #include <list>
+#include <vector>
 #include "traits.hpp"
 //#include "ESPAsyncWebServer.h"
 #include "AsyncJson.h"
 #include "embui_constants.h"
 #include "embui_defines.h"
 #include "embui_log.h"
+#include "embui_mem.hpp"
+#include "embui_values.hpp"
+#include "embui_egress.hpp"
 
 template<typename TString>
 using ValidStringRef_t = std::enable_if_t<embui_traits::is_string_obj_v<TString>, void>;
@@ -42,9 +48,41 @@ class FrameSend {
         virtual void send(const char* data) = 0;
         virtual void send(const JsonVariantConst& data) = 0;
         void send(const String &data){ send(data.c_str()); };
+
+        /**
+         * @brief send pre-serialized json frame
+         * feeders that are able to send raw json bytes should override this method along with accepts_raw()
+         * @param data - serialized frame, buffer is shared between all feeders in a chain
+         */
+        virtual void send(const AsyncWebSocketSharedBuffer& data){};
+
+        /**
+         * @brief should return 'true' if feeder could send the specified object as a pre-serialized json buffer
+         * otherwise send(const JsonVariantConst& data) is called and feeder makes it's own view of the data
+         * 
+         * @param data object to send
+         */
+        virtual bool accepts_raw(const JsonVariantConst& data) const { return false; }
+
+        /**
+         * @brief send a frame that was already serialized by the producer, i.e. streaming Interface
+         * feeders that accept raw json are given the buffer as-is, others get it deserialized back into an object
+         * 
+         * @param data - serialized frame
+         * @param hdr - frame's header, i.e. frame's root object without it's 'block' member, used with accepts_raw()
+         */
+        virtual void send(const AsyncWebSocketSharedBuffer& data, const JsonVariantConst& hdr);
         //virtual void flush(){};
 };
 
+/**
+ * @brief serialize json object into a buffer that could be shared between feeders
+ * 
+ * @param data object to serialize
+ * @return AsyncWebSocketSharedBuffer
+ */
+AsyncWebSocketSharedBuffer frame_serialize(const JsonVariantConst& data);
+
 class FrameSendWSServer: public FrameSend {
     protected:
         AsyncWebSocket *ws;
@@ -55,8 +93,11 @@ class FrameSendWSServer: public FrameSend {
             LOGV(P_EmbUI, printf, "WS cnt:%u\n", ws->count());
              return ws->count(); }
 
-        void send(const char* data) override { ws->textAll(data ? data : P_empty_quotes); };
+        void send(const char* data) override;
         void send(const JsonVariantConst& data) override;
+        void send(const AsyncWebSocketSharedBuffer& data) override { WSEgress::getInstance().send(ws, data, {}); };
+        void send(const AsyncWebSocketSharedBuffer& data, const JsonVariantConst& hdr) override { WSEgress::getInstance().send(ws, data, hdr); };
+        bool accepts_raw(const JsonVariantConst& data) const override { return true; }
 };
 
 class FrameSendWSClient: public FrameSend {
@@ -67,12 +108,15 @@ class FrameSendWSClient: public FrameSend {
         ~FrameSendWSClient() { cl = nullptr; }
         bool available() const override { return cl->status() == WS_CONNECTED; }
 
-        void send(const char* data) override { cl->text(data ? data : P_empty_quotes); };
+        void send(const char* data) override;
 
         /**
          * @brief - serialize and send json obj directly to the ws buffer
          */
         void send(const JsonVariantConst& data) override;
+        void send(const AsyncWebSocketSharedBuffer& data) override { WSEgress::getInstance().send(cl, data, {}); };
+        void send(const AsyncWebSocketSharedBuffer& data, const JsonVariantConst& hdr) override { WSEgress::getInstance().send(cl, data, hdr); };
+        bool accepts_raw(const JsonVariantConst& data) const override { return true; }
 };
 
 class FrameSendHttp: public FrameSend {
@@ -135,19 +179,26 @@ class FrameSendChain : public FrameSend {
 
     /**
      * @brief send data to all handlers in list
+     * object is serialized only once and the resulting buffer is shared between all handlers that accept raw json,
+     * other handlers are fed with the object itself
      * 
      * @param data 
      */
     void send(const JsonVariantConst& data) override;
     void send(const char* data) override;
 
+    /**
+     * @brief send pre-serialized frame to all handlers in list
+     * buffer is deserialized (only once) if there are handlers that do not accept raw json
+     */
+    void send(const AsyncWebSocketSharedBuffer& data, const JsonVariantConst& hdr) override;
+
 };
 
 class FrameSendAsyncJS: public FrameSend {
     private:
         bool flushed = false;
         AsyncWebServerRequest *req;
-        AsyncJsonResponse *response;
     public:
         explicit FrameSendAsyncJS(AsyncWebServerRequest *request) : req(request) {}
         ~FrameSendAsyncJS();
@@ -162,30 +213,145 @@ class FrameSendAsyncJS: public FrameSend {
 
 class Interface {
 
+protected:
     struct section_stack_t{
         int idx{0};
-        String name;
+        // section name, borrowed from section object in the frame document
+        const char* name{P_EMPTY};
         JsonArray block;
-        section_stack_t();
-        section_stack_t(const char* sect_name, JsonArray&& block) : name(sect_name), block(std::move(block)) {} 
+    };
+
+private:
+    /**
+     * @brief stack of opened sections
+     * entries are kept in a fixed-size array provided by the owner, or in a vector that grows on demand if none was given
+     */
+    class SectionStack {
+        section_stack_t* _items{nullptr};
+        size_t _cap{0};
+        size_t _size{0};
+        bool _fixed{false};
+        std::vector<section_stack_t> _dyn;
+
+    public:
+        SectionStack() = default;
+        SectionStack(section_stack_t* items, size_t capacity) : _items(items), _cap(capacity), _fixed(true) {}
+
+        /**
+         * @brief push a new section to stack
+         * @return false if stack has fixed capacity and it is exhausted
+         */
+        bool emplace_back(const char* name, JsonArray block){
+            if (_fixed){
+                if (_size == _cap) return false;
+            } else if (_size == _dyn.size()){
+                _dyn.emplace_back();
+                _items = _dyn.data();
+            }
+            _items[_size++] = { 0, name, block };
+            return true;
+        }
+
+        void pop_back(){ if (_size) --_size; }
+        void clear(){ _size = 0; }
+        size_t size() const { return _size; }
+        bool full() const { return _fixed && _size == _cap; }
+
+        section_stack_t& front(){ return _items[0]; }
+        section_stack_t& back(){ return _items[_size - 1]; }
+        section_stack_t* begin(){ return _items; }
+        section_stack_t* end(){ return _items + _size; }
+        std::reverse_iterator<section_stack_t*> rbegin(){ return std::reverse_iterator<section_stack_t*>(end()); }
+        std::reverse_iterator<section_stack_t*> rend(){ return std::reverse_iterator<section_stack_t*>(begin()); }
     };
 
     const bool _delete_handler_on_destruct;
-    JsonDocument json;
-    std::list<section_stack_t> section_stack;
+    // streaming mode, see json_frame_streaming()
+    bool _streaming{false};
+    // publish only changed values in value frames, see json_frame_value_delta()
+    bool _vdelta{false};
+    // frames are sent to a single client only
+    bool _unicast{false};
+    // current frame is a value frame
+    bool _value_frame{false};
+    // number of sections that were not opened due to stack's capacity exhausted
+    uint8_t _sections_dropped{0};
+    JsonDocument json{embui_mem::allocator(embui_mem::subsys_t::interface)};
+    SectionStack section_stack;
     FrameSend *send_hndl;
+    // output buffer for streaming mode, frame is serialized here on the fly
+    AsyncWebSocketSharedBuffer _obuff;
+    // frame size budget, bytes
+    size_t _budget{EMBUI_FRAME_BUDGET};
+    // estimated size of the frame's serialized objects, used in non-streaming mode
+    size_t _frame_bytes{0};
 
 
     /**
      * @brief purge json object while keeping section structure
-     * used to release mem after _json_frame_send() call
+     * used to release mem after _json_frame_send() call.
+     * Data is purged in-place, each section keeps only it's nested section object, section keys are replaced with section/idx pair
+     * that lets WebUI merge the next frame into the right place. Root section also keeps 'pkg' key,
+     * so that feeders could still tell frame's type. Section objects previously returned to the caller remain valid
      */
     void _json_frame_next();
 
+    // check if a new section could be opened
+    bool _section_available();
+
     /**
      * @brief - serialize and send Interface object to the WebSocket
+     * in streaming mode all opened sections are closed in the output buffer and the buffer is sent
+     */
+    void _json_frame_send();
+
+    /**
+     * @brief check if frame size has exceeded budget and split it if so
+     * should be called only on object boundaries, i.e. before adding a new object to a block
+     */
+    void _json_budget_check();
+
+    /**
+     * @brief send accumulated data as a continuation frame and release sent objects
+     * section objects are purged in-place, so references to opened sections remain valid
+     */
+    void _json_frame_split();
+
+    /**
+     * @brief update ValueCache with a value object that was just created with value() call
+     * in delta mode unchanged value is removed from the frame
+     * 
+     * @param o value object
+     * @param html object is a labeled html value
+     * @return JsonObject value object or null object if value was removed
      */
-    inline void _json_frame_send(){ if (send_hndl) send_hndl->send(json); };
+    JsonObject _value_cached(JsonObject o, bool html);
+
+    /**
+     * @brief add a new object to the end of current section's block
+     * in streaming mode previous objects of the block are serialized and released first
+     */
+    JsonObject _json_block_add();
+
+    /**
+     * @brief streaming mode - serialize all objects from section's block into output buffer
+     * and release it's memory
+     */
+    void _stream_emit(JsonArray block);
+
+    // streaming mode - write the head of a new section into output buffer
+    void _stream_section_open();
+
+    /**
+     * @brief streaming mode - close section's block in output buffer and write section's own keys
+     * 
+     * @param block section's block
+     * @param section section object
+     */
+    void _stream_section_close(JsonArray block, JsonObjectConst section);
+
+    // streaming mode - write the tail of a section, i.e. close it's block array and add section's keys
+    void _stream_section_tail(JsonObjectConst section);
 
     /**
      * @brief - start UI section
@@ -208,9 +374,13 @@ class Interface {
          */
         Interface (FrameSend *feeder): _delete_handler_on_destruct(false), send_hndl(feeder) {}
 
+        /**
+         * @brief Construct a new Interface object that publishes to all WebSocket clients
+         */
         explicit Interface(AsyncWebSocket *server): _delete_handler_on_destruct(true), send_hndl(new FrameSendWSServer(server)) {}
-        explicit Interface(AsyncWebSocketClient *client): _delete_handler_on_destruct(true), send_hndl(new FrameSendWSClient(client)) {}
-        explicit Interface(AsyncWebServerRequest *request): _delete_handler_on_destruct(true), send_hndl(new FrameSendAsyncJS(request)) {}
+        explicit Interface(AsyncWebSocketClient *client): _delete_handler_on_destruct(true), _unicast(true), send_hndl(new FrameSendWSClient(client)) {}
+        // http reply could be sent only once, so frames are never split
+        explicit Interface(AsyncWebServerRequest *request): _delete_handler_on_destruct(true), _unicast(true), send_hndl(new FrameSendAsyncJS(request)), _budget(0) {}
 
         // no copy c-tor
         Interface(const Interface&) = delete;
@@ -218,6 +388,20 @@ class Interface {
         // d-tor
         ~Interface();
 
+    protected:
+        /**
+         * @brief Construct a new Interface object with caller-provided storage, see InterfaceFixed
+         * 
+         * @param feeder an FrameSender object to use for sending data
+         * @param sections array for sections stack
+         * @param depth size of sections array, i.e. max sections nesting depth
+         * @param alloc allocator for frame's JsonDocument
+         */
+        Interface(FrameSend *feeder, section_stack_t* sections, size_t depth, ArduinoJson::Allocator* alloc) :
+            _delete_handler_on_destruct(false), json(alloc), section_stack(sections, depth), send_hndl(feeder) {}
+
+    public:
+
 
         /**
          * @brief - begin UI secton of the specified <type>
@@ -230,6 +414,43 @@ class Interface {
          * 
          */
         void json_frame_clear();
+
+        /**
+         * @brief switch Interface into streaming mode
+         * in streaming mode UI objects are serialized into output buffer as soon as the next object
+         * or section is started, only currently opened sections and the last object are kept in memory.
+         * It saves a lot of heap when generating large pages, since a complete frame never exists both
+         * as a JsonDocument and it's serialized copy. The frame protocol (section/idx/final) is not changed.
+         * @note objects could be altered with json_object_get()/json_block_get() until next object/section is created,
+         * previous objects are not accessible anymore
+         * @note has no effect if a frame is already opened
+         * 
+         * @param enable 
+         */
+        void json_frame_streaming(bool enable);
+
+        /**
+         * @brief set frame size budget
+         * when accumulated frame data exceeds the budget, it is sent as a continuation frame
+         * (same as json_frame_send() call) before adding next UI object. Section nesting and indexes
+         * are preserved, so WebUI reassembles the frame transparently.
+         * Section objects returned to the caller remain valid on such a split, previously created UI objects do not.
+         * Default budget is EMBUI_FRAME_BUDGET
+         * 
+         * @param bytes - frame size, 0 - disable auto-splitting
+         */
+        void json_frame_budget(size_t bytes);
+
+        /**
+         * @brief publish only changed values in value frames
+         * all values added via value() calls are kept in ValueCache, when delta mode is enabled
+         * a value is skipped if it is unchanged (or changed less than threshold set for the key)
+         * since the last publish. Value frames without changed values are not sent at all.
+         * Disabled by default, i.e. a value could be re-sent to resync UI widgets
+         * 
+         * @param enable 
+         */
+        void json_frame_value_delta(bool enable){ _vdelta = enable; }
         
         /**
          * @brief finalize, send and clear current sections stack and frame data
@@ -237,6 +458,38 @@ class Interface {
          */
         void json_frame_flush();
 
+        /**
+         * @brief send a pre-serialized frame as-is
+         * used to send static pages made with embui_page DSL, any opened frame is flushed first.
+         * Feeders that can't send raw json get the frame deserialized
+         * 
+         * @param frame serialized complete frame
+         * @param len frame length
+         * @param type frame's 'pkg' type
+         */
+        void json_frame_static(const char* frame, size_t len, const char* type = P_interface);
+
+        /**
+         * @brief send a pre-serialized frame as-is, buffer is shared with feeders without copying
+         * 
+         * @param frame serialized complete frame
+         * @param type frame's 'pkg' type
+         */
+        void json_frame_static(const AsyncWebSocketSharedBuffer& frame, const char* type = P_interface);
+
+        /**
+         * @brief replace frame sender
+         * any opened frame is flushed to the current sender first. Previous sender is not deleted,
+         * it should be set back before Interface is destroyed, i.e. used to wrap sender for frames capture, see FrameCache
+         * 
+         * @param feeder new sender
+         * @return FrameSend* previous sender
+         */
+        FrameSend* feeder(FrameSend *feeder);
+
+        // current frame sender
+        FrameSend* feeder() const { return send_hndl; }
+
         /**
          * @brief - begin Interface UI secton
          * used to construct WebUI html elements
@@ -277,6 +530,11 @@ class Interface {
          */
         void json_frame_send();
 
+        /**
+         * @brief check if there is an opened frame
+         */
+        bool json_frame_open() const { return section_stack.size(); }
+
         /**
          * @brief - begin Value UI frame
          * used to supply WebUI with data (key:value pairs)
@@ -952,10 +1210,43 @@ class Interface {
          * 
          * @param data - object to add as values. Might be an arrray 
          */
-        JsonObject value(const JsonVariantConst data){ return json_object_add(data); }
+        JsonObject value(const JsonVariantConst data);
 
 };
 
+/**
+ * @brief Interface with fixed capacity that does not use heap
+ * sections stack has compile-time max nesting depth and frame's JsonDocument lives in a caller-provided buffer,
+ * section names are not copied. It is meant for high-rate publishers, i.e. sending value frames periodically,
+ * frames are built with no heap allocations (streaming mode still allocates it's output buffer).
+ * Sections exceeding max depth are not opened, and frame data that does not fit into buffer is dropped,
+ * check allocator's stats() for failed allocations.
+ * Send handler is not owned by InterfaceFixed, it must outlive the object
+ * 
+ * @tparam Depth max sections nesting depth, including frame's root section
+ */
+template <size_t Depth>
+class InterfaceFixed : public Interface {
+    section_stack_t _sections[Depth];
+    embui_mem::BufferAllocator _alloc;
+
+public:
+    /**
+     * @brief Construct a new InterfaceFixed object
+     * 
+     * @param feeder an FrameSender object to use for sending data, i.e. &embui.feeders
+     * @param buff buffer for frame's JsonDocument, must be 8-byte aligned and outlive the object
+     * @param size buffer size
+     */
+    InterfaceFixed(FrameSend *feeder, void* buff, size_t size) : Interface(feeder, _sections, Depth, &_alloc), _alloc(buff, size) {}
+
+    // release frame's data while buffer allocator is still alive
+    ~InterfaceFixed(){ json_frame_clear(); }
+
+    // frame document's memory stats
+    embui_mem::stat_t stats() const { return _alloc.stats(); }
+};
+
 
 /* *** TEMPLATED CLASSES implementation follows *** */
 
@@ -1074,9 +1365,11 @@ JsonObject Interface::json_frame_jscall(const TChar* function){
 
 template  <typename TAdaptedString, typename L>
 void Interface::_json_section_begin(TAdaptedString name, const L label, bool main, bool hidden, bool line, bool replace, JsonObject obj){
-    if (embui_traits::is_empty_string(name))
-        obj[P_section] = String (std::rand()); // need a deep-copy
-    else
+    if (embui_traits::is_empty_string(name)){
+        char rnd[12];
+        std::snprintf(rnd, sizeof(rnd), "%d", std::rand());
+        obj[P_section] = rnd;       // need a deep-copy
+    } else
         obj[P_section] = name;
 
     if (!embui_traits::is_empty_string(label)) obj[P_label] = label;
@@ -1087,19 +1380,22 @@ void Interface::_json_section_begin(TAdaptedString name, const L label, bool mai
 
     // add a new section to the stack
     section_stack.emplace_back(obj[P_section].as<const char*>(), obj[P_block].to<JsonArray>());
-    LOGD(P_EmbUI, printf, "section begin #%u '%s'\n", section_stack.size(), section_stack.back().name.isEmpty() ? "-" : section_stack.back().name.c_str());   // section index counts from 0, so I print in fo BEFORE adding section to stack
+    if (_streaming) _stream_section_open();
+    LOGD(P_EmbUI, printf, "section begin #%u '%s'\n", section_stack.size(), *section_stack.back().name ? section_stack.back().name : "-");   // section index counts from 0, so I print in fo BEFORE adding section to stack
     //return JsonArrayConst(section_stack.back().block);
 }
 
 template  <typename TString, typename L>
 JsonObject Interface::json_section_begin(const TString& name, const L label, bool main, bool hidden, bool line, bool replace){
-    JsonObject obj(section_stack.size() ? section_stack.back().block.add<JsonObject>() : json.as<JsonObject>());
+    if (!_section_available()) return {};
+    JsonObject obj(section_stack.size() ? _json_block_add() : json.as<JsonObject>());
     _json_section_begin(detail::adaptString(name), label, main, hidden, line, replace, obj);
     return obj;
 }
 template  <typename TChar, typename L>
 JsonObject Interface::json_section_begin(const TChar* name, const L label, bool main, bool hidden, bool line, bool replace){
-    JsonObject obj(section_stack.size() ? section_stack.back().block.add<JsonObject>() : json.as<JsonObject>());
+    if (!_section_available()) return {};
+    JsonObject obj(section_stack.size() ? _json_block_add() : json.as<JsonObject>());
     _json_section_begin(detail::adaptString(name), label, main, hidden, line, replace, obj);
     return obj;
 }
@@ -1107,6 +1403,7 @@ JsonObject Interface::json_section_begin(const TChar* name, const L label, bool
 template  <typename ID>
     typename std::enable_if<embui_traits::is_string_v<ID>,JsonObject>::type
 Interface::json_section_extend(const ID name){
+    if (!section_stack.size() || !_section_available()) return {};
     section_stack.back().idx--;                                   // decrement section index
     JsonObject o(section_stack.back().block[section_stack.back().block.size()-1]);    // find last array element
     _json_section_begin(name, P_EMPTY, false, false, false, false, o);
@@ -1226,7 +1523,7 @@ JsonObject Interface::value(const ID id, const T value, bool html){
     } else {
         o[id] = value;
     }
-    return o;
+    return _value_cached(o, html);
 };
 
 template <typename TChar, typename V, typename L>
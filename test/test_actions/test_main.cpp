@@ -0,0 +1,157 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+/**
+ * ActionHandler dispatch benchmark
+ * indexed ActionHandler::exec() is compared to a linear scan over a list of handlers (the way actions were looked up before),
+ * dispatch cost is measured against the number of registered actions, both dispatchers must match the same handlers
+ */
+
+#include <list>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <Arduino.h>
+#include <unity.h>
+#include "EmbUI.h"
+
+// number of registered actions to benchmark with
+static constexpr size_t sizes[] = { 10, 50, 100, 250, 500, 1000 };
+// lookups per measurement
+static constexpr size_t rounds = 2000;
+
+/**
+ * @brief reference dispatcher, a linear scan with string compares for every registered handler
+ */
+class LinearDispatch {
+    struct handler_t {
+        const char* action;
+        embui_cb_t cb;
+    };
+    std::list<handler_t> _actions;
+
+    static bool starts_with(std::string_view s, std::string_view p){ return s.substr(0, p.size()) == p; }
+    static bool ends_with(std::string_view s, std::string_view p){ return s.size() >= p.size() && s.compare(s.size() - p.size(), std::string_view::npos, p) == 0; }
+
+public:
+    void add(const char* id, const embui_cb_t& cb){ _actions.push_back({id, cb}); }
+
+    size_t exec(Interface *interf, JsonVariantConst data, const char* action){
+        size_t cnt{0};
+        std::string_view a(action);
+        for (const auto& i : _actions){
+            std::string_view item(i.action);
+            if (a.length() < item.length()) continue;
+            if (item.back() == '*' && !starts_with(a, item.substr(0, item.size()-1))) continue;
+            if (item.front() == '*' && !ends_with(a, item.substr(1))) continue;
+            if (item.back() != '*' && item.front() != '*' && a.compare(item) != 0) continue;
+            i.cb(interf, data, action);
+            ++cnt;
+        }
+        return cnt;
+    }
+};
+
+// handler names must outlive dispatchers, those are not copied
+static std::vector<std::string> names;
+// posted actions: exact matches, prefix and suffix mask matches and misses
+static std::vector<std::string> posts;
+static uint32_t calls{0};
+
+static void cb(Interface *interf, JsonVariantConst data, const char* action){ ++calls; }
+
+// registered set is alike to a real firmware: mostly exact names and some unit's namespace masks
+static void make_names(size_t n){
+    names.clear();
+    names.reserve(n);
+    posts.clear();
+    for (size_t i = 0; i != n; ++i){
+        switch (i % 8){
+            case 6 :
+                names.emplace_back("unit" + std::to_string(i) + "_set_*");
+                posts.emplace_back("unit" + std::to_string(i) + "_set_mode");
+                break;
+            case 7 :
+                names.emplace_back("*_get" + std::to_string(i));
+                posts.emplace_back("unit_get" + std::to_string(i));
+                break;
+            default :
+                names.emplace_back("ui_action_" + std::to_string(i));
+                posts.emplace_back("ui_action_" + std::to_string(i));
+                // unknown action
+                if (i % 8 == 5) posts.emplace_back("ui_missing_" + std::to_string(i));
+        }
+    }
+}
+
+// average time of a single exec() call, ns
+template <typename D>
+static uint32_t measure(D& dispatcher){
+    calls = 0;
+    int64_t t = esp_timer_get_time();
+    for (size_t r = 0; r != rounds; ++r)
+        dispatcher.exec(nullptr, {}, posts[r % posts.size()].c_str());
+    int64_t dt = esp_timer_get_time() - t;
+    return static_cast<uint32_t>(dt * 1000 / rounds);
+}
+
+void test_same_matches(){
+    make_names(200);
+    ActionHandler indexed;
+    LinearDispatch linear;
+    for (const auto& n : names){
+        indexed.add(n.c_str(), cb);
+        linear.add(n.c_str(), cb);
+    }
+    // overlapping masks, both must match
+    indexed.add("ui_*", cb);
+    linear.add("ui_*", cb);
+    indexed.add("*_mode", cb);
+    linear.add("*_mode", cb);
+
+    for (const auto& p : posts)
+        TEST_ASSERT_EQUAL_MESSAGE(linear.exec(nullptr, {}, p.c_str()), indexed.exec(nullptr, {}, p.c_str()), p.c_str());
+}
+
+void test_dispatch_cost(){
+    char msg[96];
+    TEST_MESSAGE("actions\tlinear,ns\tindexed,ns");
+    for (size_t n : sizes){
+        make_names(n);
+        ActionHandler indexed;
+        LinearDispatch linear;
+        for (const auto& name : names){
+            indexed.add(name.c_str(), cb);
+            linear.add(name.c_str(), cb);
+        }
+
+        uint32_t tl = measure(linear);
+        uint32_t cl = calls;
+        uint32_t ti = measure(indexed);
+        TEST_ASSERT_EQUAL_UINT32(cl, calls);
+
+        std::snprintf(msg, sizeof(msg), "%u\t%lu\t%lu", static_cast<unsigned>(n), static_cast<unsigned long>(tl), static_cast<unsigned long>(ti));
+        TEST_MESSAGE(msg);
+        if (n >= 100)
+            TEST_ASSERT_LESS_THAN_UINT32(tl, ti);
+    }
+}
+
+void setup(){
+    delay(2000);    // wait for serial monitor
+    UNITY_BEGIN();
+    RUN_TEST(test_same_matches);
+    RUN_TEST(test_dispatch_cost);
+    UNITY_END();
+}
+
+void loop(){
+    delay(1000);
+}
@@ -0,0 +1,147 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+/**
+ * ValueBus multi-task stress test
+ * producer tasks on both cores post values concurrently while the test task drains the bus, the same way EmbUI::handle() does.
+ * Every posted value must be consumed once, values of each key must arrive in order and string values must not be torn.
+ * Posting and draining throughput is printed as test messages
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <Arduino.h>
+#include <unity.h>
+#include "embui_bus.hpp"
+
+static constexpr size_t producers = 4;
+// values posted by each producer
+static constexpr uint32_t values = 20000;
+
+// keys must have static storage
+static const char* const num_keys[producers] = { "n0", "n1", "n2", "n3" };
+static const char* const str_keys[producers] = { "s0", "s1", "s2", "s3" };
+
+static ValueBus bus;
+static std::atomic<uint32_t> posted{0};
+static std::atomic<size_t> done{0};
+
+// producer posts a counter and it's string form, a post is retried until the bus accepts it
+static void producer(void* arg){
+    size_t id = reinterpret_cast<size_t>(arg);
+    char s[EMBUI_BUS_STR_LEN];
+    for (uint32_t i = 0; i != values; ++i){
+        while (!bus.post(num_keys[id], i))
+            taskYIELD();
+        std::snprintf(s, sizeof(s), "%u:%lu", static_cast<unsigned>(id), static_cast<unsigned long>(i));
+        while (!bus.post(str_keys[id], s))
+            taskYIELD();
+        posted += 2;
+    }
+    ++done;
+    vTaskDelete(NULL);
+}
+
+void test_concurrent_producers(){
+    JsonDocument doc;
+    int32_t last_num[producers];
+    int32_t last_str[producers];
+    for (size_t i = 0; i != producers; ++i)
+        last_num[i] = last_str[i] = -1;
+
+    size_t consumed{0};
+    uint32_t drains{0};
+    uint32_t drops = bus.drops();
+    int64_t t = esp_timer_get_time();
+
+    for (size_t i = 0; i != producers; ++i)
+        xTaskCreatePinnedToCore(producer, "bus_prod", 4096, reinterpret_cast<void*>(i), 1, NULL, i % 2);
+
+    for (;;){
+        bool finished = done == producers;
+        doc.clear();
+        consumed += bus.drain(doc.to<JsonObject>());
+        ++drains;
+
+        for (size_t i = 0; i != producers; ++i){
+            JsonVariantConst n = doc[num_keys[i]];
+            if (!n.isNull()){
+                TEST_ASSERT_TRUE(n.is<uint32_t>());
+                // coalesced values of a key are never older than the ones consumed before
+                TEST_ASSERT_GREATER_OR_EQUAL_INT32(last_num[i], n.as<int32_t>());
+                last_num[i] = n.as<int32_t>();
+            }
+            JsonVariantConst s = doc[str_keys[i]];
+            if (!s.isNull()){
+                unsigned id;
+                unsigned long cnt;
+                TEST_ASSERT_EQUAL_MESSAGE(2, std::sscanf(s.as<const char*>(), "%u:%lu", &id, &cnt), s.as<const char*>());
+                TEST_ASSERT_EQUAL_UINT(i, id);
+                TEST_ASSERT_GREATER_OR_EQUAL_INT32(last_str[i], static_cast<int32_t>(cnt));
+                last_str[i] = cnt;
+            }
+        }
+        // last drain after all producers are done must empty the bus
+        if (finished && !bus.size()) break;
+        // leave cpu to producers on this core, like EmbUI's periodic drain does
+        if (drains % 16 == 0) vTaskDelay(1);
+    }
+
+    int64_t dt = esp_timer_get_time() - t;
+
+    TEST_ASSERT_EQUAL_UINT32(producers * values * 2, posted);
+    TEST_ASSERT_EQUAL_UINT32(posted, consumed);
+    for (size_t i = 0; i != producers; ++i){
+        TEST_ASSERT_EQUAL_INT32(values - 1, last_num[i]);
+        TEST_ASSERT_EQUAL_INT32(values - 1, last_str[i]);
+    }
+
+    char msg[128];
+    std::snprintf(msg, sizeof(msg), "%u producers, %lu values in %lu ms: %lu values/s, %lu drains, %lu full queue retries",
+        static_cast<unsigned>(producers), static_cast<unsigned long>(consumed), static_cast<unsigned long>(dt / 1000),
+        static_cast<unsigned long>(consumed * 1000000ULL / dt), static_cast<unsigned long>(drains), static_cast<unsigned long>(bus.drops() - drops));
+    TEST_MESSAGE(msg);
+}
+
+// single producer on the consumer's task, posting cost alone
+void test_post_cost(){
+    JsonDocument doc;
+    uint32_t cnt{0};
+    int64_t t = esp_timer_get_time();
+    for (uint32_t i = 0; i != values; ++i){
+        if (!bus.post(num_keys[0], i)){
+            doc.clear();
+            bus.drain(doc.to<JsonObject>());
+            bus.post(num_keys[0], i);
+        }
+        ++cnt;
+    }
+    int64_t dt = esp_timer_get_time() - t;
+    doc.clear();
+    bus.drain(doc.to<JsonObject>());
+    TEST_ASSERT_EQUAL_UINT32(values - 1, doc[num_keys[0]].as<uint32_t>());
+
+    char msg[96];
+    std::snprintf(msg, sizeof(msg), "post+drain: %lu ns per value", static_cast<unsigned long>(dt * 1000 / cnt));
+    TEST_MESSAGE(msg);
+}
+
+void setup(){
+    delay(2000);    // wait for serial monitor
+    UNITY_BEGIN();
+    RUN_TEST(test_post_cost);
+    RUN_TEST(test_concurrent_producers);
+    UNITY_END();
+}
+
+void loop(){
+    delay(1000);
+}
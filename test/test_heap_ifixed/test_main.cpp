@@ -0,0 +1,185 @@
+/*
+    This file is part of EmbUI project
+    https://github.com/vortigont/EmbUI
+
+    Copyright © 2023 Emil Muratov (Vortigont)   https://github.com/vortigont/
+
+    EmbUI is free software: you can redistribute it and/or modify
+    it under the terms of MIT License https://opensource.org/license/mit/
+*/
+
+/**
+ * InterfaceFixed must build and send frames with no heap allocations.
+ * malloc family calls are wrapped by the linker (see env:esp32_heap), calls made from the test task are counted,
+ * JsonDocuments that use EmbUI's allocators are accounted with embui_mem counters
+ */
+
+#include <atomic>
+#include <Arduino.h>
+#include <unity.h>
+#include "ui.h"
+#include "embui_mem.hpp"
+
+static std::atomic<uint32_t> heap_allocs{0};
+// only allocations made by this task are counted
+static TaskHandle_t counted_task{nullptr};
+
+static inline void count_alloc(){
+    if (counted_task && xTaskGetCurrentTaskHandle() == counted_task) ++heap_allocs;
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size){ count_alloc(); return __real_malloc(size); }
+void* __wrap_calloc(size_t n, size_t size){ count_alloc(); return __real_calloc(n, size); }
+void* __wrap_realloc(void* ptr, size_t size){ count_alloc(); return __real_realloc(ptr, size); }
+}
+
+// allocations made so far by EmbUI's JsonDocument allocators
+static uint32_t embui_allocs(){
+    uint32_t cnt{0};
+    for (uint8_t s = 0; s != static_cast<uint8_t>(embui_mem::subsys_t::count); ++s)
+        cnt += embui_mem::stats(static_cast<embui_mem::subsys_t>(s)).allocs;
+    return cnt;
+}
+
+// total allocations counter
+static uint32_t allocs(){ return heap_allocs + embui_allocs(); }
+
+/**
+ * @brief feeder that only counts frames, it does not keep or copy the data
+ */
+class CountingFeeder : public FrameSend {
+public:
+    uint32_t frames{0};
+    size_t bytes{0};
+
+    bool available() const override { return true; }
+    void send(const char* data) override { ++frames; bytes += std::strlen(data); }
+    void send(const JsonVariantConst& data) override { ++frames; bytes += measureJson(data); }
+};
+
+static const char* const ids[] = { "temp", "hum", "press", "lux", "volt", "amp", "state", "cnt" };
+
+static CountingFeeder feeder;
+alignas(8) static uint8_t frame_buff[4096];
+
+// a value frame, same as periodic publishers do
+static void build_value_frame(Interface &interf, int seq){
+    interf.json_frame_value();
+    for (size_t i = 0; i != std::size(ids); ++i){
+        if (i % 2)
+            interf.value(ids[i], seq + static_cast<int>(i));
+        else
+            interf.value(ids[i], 0.5f * seq + i);
+    }
+    interf.json_frame_flush();
+}
+
+// an interface frame with nested sections
+static void build_ui_frame(Interface &interf, int seq){
+    interf.json_frame_interface();
+    interf.json_section_main("main", "Main");
+    interf.json_section_line("line");
+    interf.number("temp", seq, "Temperature");
+    interf.range("lux", seq, 0, 1000, 1, "Lux");
+    interf.json_section_end();
+    interf.comment("info", "comment");
+    interf.json_frame_flush();
+}
+
+void setUp(){
+    feeder.frames = 0;
+    feeder.bytes = 0;
+}
+
+void tearDown(){
+    counted_task = nullptr;
+}
+
+void test_value_frame_no_alloc(){
+    InterfaceFixed<4> interf(&feeder, frame_buff, sizeof(frame_buff));
+
+    // first publish creates ValueCache entries for the keys, that is allowed to allocate
+    build_value_frame(interf, 0);
+
+    counted_task = xTaskGetCurrentTaskHandle();
+    uint32_t before = allocs();
+    for (int i = 1; i != 100; ++i)
+        build_value_frame(interf, i);
+    uint32_t n = allocs() - before;
+    counted_task = nullptr;
+
+    TEST_ASSERT_EQUAL_UINT32(100, feeder.frames);
+    TEST_ASSERT_EQUAL_UINT32(0, interf.stats().fails);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, n, "heap allocations while building value frames");
+}
+
+void test_ui_frame_no_alloc(){
+    InterfaceFixed<4> interf(&feeder, frame_buff, sizeof(frame_buff));
+
+    counted_task = xTaskGetCurrentTaskHandle();
+    uint32_t before = allocs();
+    for (int i = 0; i != 100; ++i)
+        build_ui_frame(interf, i);
+    uint32_t n = allocs() - before;
+    counted_task = nullptr;
+
+    TEST_ASSERT_EQUAL_UINT32(100, feeder.frames);
+    TEST_ASSERT_EQUAL_UINT32(0, interf.stats().fails);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, n, "heap allocations while building interface frames");
+}
+
+// counter itself must see allocations, otherwise tests above prove nothing
+void test_heap_interface_allocates(){
+    counted_task = xTaskGetCurrentTaskHandle();
+    uint32_t before = allocs();
+    {
+        Interface interf(&feeder);
+        build_ui_frame(interf, 0);
+    }
+    uint32_t n = allocs() - before;
+    counted_task = nullptr;
+
+    TEST_ASSERT_EQUAL_UINT32(1, feeder.frames);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, n);
+}
+
+// sections deeper than Depth are dropped, and frame data that does not fit into buffer is not allocated from heap
+void test_limits(){
+    alignas(8) static uint8_t small_buff[1024];
+    InterfaceFixed<2> interf(&feeder, small_buff, sizeof(small_buff));
+
+    counted_task = xTaskGetCurrentTaskHandle();
+    uint32_t before = allocs();
+    interf.json_frame_interface();
+    interf.json_section_begin("s1");
+    TEST_ASSERT_TRUE(interf.json_section_begin("s2").isNull());
+    for (int i = 0; i != 200; ++i)
+        interf.number("n", i, "number");
+    interf.json_section_end();
+    interf.json_section_end();
+    interf.json_frame_flush();
+    uint32_t n = allocs() - before;
+    counted_task = nullptr;
+
+    TEST_ASSERT_EQUAL_UINT32(0, n);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, interf.stats().fails);
+}
+
+void setup(){
+    delay(2000);    // wait for serial monitor
+    UNITY_BEGIN();
+    RUN_TEST(test_heap_interface_allocates);
+    RUN_TEST(test_value_frame_no_alloc);
+    RUN_TEST(test_ui_frame_no_alloc);
+    RUN_TEST(test_limits);
+    UNITY_END();
+}
+
+void loop(){
+    delay(1000);
+}